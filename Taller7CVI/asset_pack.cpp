@@ -0,0 +1,188 @@
+#include "asset_pack.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		const char PACK_MAGIC[4] = { 'T', '7', 'P', 'K' };
+		const uint32_t PACK_VERSION = 1;
+		const size_t HEADER_SIZE = 16;         // magic, versión, cantidad, reservado
+		const size_t NAME_SIZE = 64;
+		const size_t ENTRY_SIZE = NAME_SIZE + 32; // nombre, tipo, reservado, offset, tamaño, hash
+
+		uint32_t read32(const unsigned char* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint64_t read64(const unsigned char* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		void write32(std::vector<unsigned char>& out, uint32_t value)
+		{
+			for (int i = 0; i < 4; i++)
+				out.push_back((unsigned char)(value >> (8 * i)));
+		}
+
+		void write64(std::vector<unsigned char>& out, uint64_t value)
+		{
+			for (int i = 0; i < 8; i++)
+				out.push_back((unsigned char)(value >> (8 * i)));
+		}
+
+		size_t alignUp(size_t offset)
+		{
+			return (offset + AssetPack::ALIGNMENT - 1) / AssetPack::ALIGNMENT * AssetPack::ALIGNMENT;
+		}
+
+	}
+
+	uint64_t hashContent(const unsigned char* bytes, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool AssetPack::open(const std::string& path)
+	{
+		close();
+		if (!file.open(path))
+			return false;
+		const unsigned char* data = file.data();
+		size_t size = file.size();
+		if (size < HEADER_SIZE || memcmp(data, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0
+			|| read32(data + 4) != PACK_VERSION) {
+			std::cout << "Error al abrir el paquete " << path << ": formato desconocido" << std::endl;
+			close();
+			return false;
+		}
+		uint32_t count = read32(data + 8);
+		if (size < HEADER_SIZE + (size_t)count * ENTRY_SIZE) {
+			std::cout << "Error al abrir el paquete " << path << ": índice incompleto" << std::endl;
+			close();
+			return false;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			const unsigned char* entry = data + HEADER_SIZE + (size_t)i * ENTRY_SIZE;
+			AssetBlob blob;
+			blob.name.assign((const char*)entry, strnlen((const char*)entry, NAME_SIZE));
+			blob.kind = (AssetKind)read32(entry + NAME_SIZE);
+			size_t offset = (size_t)read64(entry + NAME_SIZE + 8);
+			blob.size = (size_t)read64(entry + NAME_SIZE + 16);
+			blob.hash = read64(entry + NAME_SIZE + 24);
+			if (offset > size || blob.size > size - offset) {
+				std::cout << "Error al abrir el paquete " << path << ": " << blob.name << " fuera del archivo" << std::endl;
+				close();
+				return false;
+			}
+			blob.data = data + offset;
+			blobs.push_back(blob);
+		}
+		return true;
+	}
+
+	void AssetPack::close()
+	{
+		blobs.clear();
+		file.close();
+	}
+
+	const AssetBlob* AssetPack::find(const std::string& name) const
+	{
+		for (const AssetBlob& blob : blobs) {
+			if (blob.name == name)
+				return &blob;
+		}
+		return nullptr;
+	}
+
+	bool writeAssetPack(const std::string& path, const std::vector<AssetSource>& assets)
+	{
+		std::vector<unsigned char> header(PACK_MAGIC, PACK_MAGIC + sizeof(PACK_MAGIC));
+		write32(header, PACK_VERSION);
+		write32(header, (uint32_t)assets.size());
+		write32(header, 0);
+		size_t offset = alignUp(HEADER_SIZE + assets.size() * ENTRY_SIZE);
+		std::vector<size_t> offsets;
+		for (const AssetSource& asset : assets) {
+			if (asset.name.size() >= NAME_SIZE) {
+				std::cout << "Error al empaquetar " << asset.name << ": nombre demasiado largo" << std::endl;
+				return false;
+			}
+			char name[NAME_SIZE] = {};
+			memcpy(name, asset.name.data(), asset.name.size());
+			header.insert(header.end(), name, name + NAME_SIZE);
+			write32(header, asset.kind);
+			write32(header, 0);
+			write64(header, offset);
+			write64(header, asset.bytes.size());
+			write64(header, hashContent(asset.bytes.data(), asset.bytes.size()));
+			offsets.push_back(offset);
+			offset = alignUp(offset + asset.bytes.size());
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "Error al crear " << path << std::endl;
+			return false;
+		}
+		file.write((const char*)header.data(), header.size());
+		size_t written = header.size();
+		static const char padding[AssetPack::ALIGNMENT] = {};
+		for (size_t i = 0; i < assets.size(); i++) {
+			file.write(padding, offsets[i] - written);
+			file.write((const char*)assets[i].bytes.data(), assets[i].bytes.size());
+			written = offsets[i] + assets[i].bytes.size();
+		}
+		return (bool)file;
+	}
+
+	std::vector<unsigned char> meshBlob(const MeshData& mesh)
+	{
+		std::vector<unsigned char> bytes;
+		write32(bytes, (uint32_t)mesh.vertices.size());
+		write32(bytes, (uint32_t)mesh.indices.size());
+		const unsigned char* vertices = (const unsigned char*)mesh.vertices.data();
+		bytes.insert(bytes.end(), vertices, vertices + mesh.vertices.size() * sizeof(PackedVertex));
+		const unsigned char* indices = (const unsigned char*)mesh.indices.data();
+		bytes.insert(bytes.end(), indices, indices + mesh.indices.size() * sizeof(uint16_t));
+		return bytes;
+	}
+
+	bool readMeshBlob(const AssetBlob& blob, MeshView& view)
+	{
+		if (blob.kind != ASSET_MESH || blob.size < 8)
+			return false;
+		size_t vertexCount = read32(blob.data), indexCount = read32(blob.data + 4);
+		if (blob.size != 8 + vertexCount * sizeof(PackedVertex) + indexCount * sizeof(uint16_t)
+			|| indexCount % 3 != 0)
+			return false;
+		// Los recursos empiezan alineados a página y PackedVertex mide 20
+		// bytes, así que ambos arreglos quedan alineados a su tipo
+		const uint16_t* indices = (const uint16_t*)(blob.data + 8 + vertexCount * sizeof(PackedVertex));
+		// Un índice fuera de la malla leería vértices ajenos en el buffer compartido
+		for (size_t i = 0; i < indexCount; i++) {
+			if (indices[i] >= vertexCount)
+				return false;
+		}
+		view.vertices = (const PackedVertex*)(blob.data + 8);
+		view.vertexCount = vertexCount;
+		view.indices = indices;
+		view.indexCount = indexCount;
+		return true;
+	}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+namespace myopengl {
+
+	enum AssetKind : uint32_t {
+		ASSET_IMAGE = 0,   // archivo de imagen tal cual (jpg, png...)
+		ASSET_KTX2 = 1,    // textura cocinada
+		ASSET_MESH = 2     // MeshData serializada (ver meshBlob)
+	};
+
+	// Un recurso dentro del paquete: data apunta a la proyección del archivo
+	struct AssetBlob {
+		std::string name;
+		AssetKind kind = ASSET_IMAGE;
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+		uint64_t hash = 0;
+	};
+
+	// Recurso a empaquetar
+	struct AssetSource {
+		std::string name;
+		AssetKind kind = ASSET_IMAGE;
+		std::vector<unsigned char> bytes;
+	};
+
+	// Hash FNV-1a de 64 bits (el mismo para el paquete y los archivos sueltos)
+	uint64_t hashContent(const unsigned char* bytes, size_t size);
+
+	// Paquete de recursos de solo lectura: una cabecera con el índice y
+	// cada recurso alineado a página, todo proyectado en memoria. Los
+	// recursos se leen directamente de la caché de páginas del sistema,
+	// sin copiarlos a memoria propia; el paquete tiene que seguir abierto
+	// mientras se usen sus datos.
+	class AssetPack {
+	public:
+		static const size_t ALIGNMENT = 4096;
+
+		AssetPack() = default;
+		AssetPack(const AssetPack&) = delete;
+		AssetPack& operator=(const AssetPack&) = delete;
+
+		// false si no existe o el índice no es válido
+		bool open(const std::string& path);
+		void close();
+		bool isOpen() const { return file.isOpen(); }
+
+		// nullptr si el paquete no tiene ese recurso
+		const AssetBlob* find(const std::string& name) const;
+		const std::vector<AssetBlob>& assets() const { return blobs; }
+		size_t size() const { return file.size(); }
+
+	private:
+		MappedFile file;
+		std::vector<AssetBlob> blobs;
+	};
+
+	bool writeAssetPack(const std::string& path, const std::vector<AssetSource>& assets);
+
+	// Serializa una malla: cantidades de vértices e índices, los vértices
+	// y después los índices
+	std::vector<unsigned char> meshBlob(const MeshData& mesh);
+	// Vista de la malla sobre los bytes del recurso; false si no es válido
+	// (tamaño incoherente, triángulos incompletos o índices fuera de la malla)
+	bool readMeshBlob(const AssetBlob& blob, MeshView& view);
+
+}
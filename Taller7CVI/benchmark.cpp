@@ -0,0 +1,162 @@
+#include "benchmark.hpp"
+#include <cstdio>
+
+namespace myopengl {
+
+	GpuTimer::~GpuTimer()
+	{
+		destroy();
+	}
+
+	void GpuTimer::create()
+	{
+		destroy();
+		glGenQueries(QUERY_COUNT, queries);
+	}
+
+	void GpuTimer::destroy()
+	{
+		if (queries[0])
+			glDeleteQueries(QUERY_COUNT, queries);
+		for (int i = 0; i < QUERY_COUNT; i++) {
+			queries[i] = 0;
+			pending[i] = false;
+		}
+	}
+
+	void GpuTimer::begin()
+	{
+		// Si la consulta de este hueco sigue pendiente se lee (puede bloquear
+		// solo si la GPU va QUERY_COUNT frames atrás)
+		if (pending[current]) {
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &elapsed);
+			lastMs = elapsed / 1.0e6;
+			pending[current] = false;
+		}
+		glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+	}
+
+	void GpuTimer::end()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		pending[current] = true;
+		current = (current + 1) % QUERY_COUNT;
+		// Recoger cualquier resultado ya disponible sin esperar
+		for (int i = 0; i < QUERY_COUNT; i++) {
+			int slot = (current + i) % QUERY_COUNT;
+			if (!pending[slot])
+				continue;
+			GLint available = 0;
+			glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+			lastMs = elapsed / 1.0e6;
+			pending[slot] = false;
+		}
+	}
+
+	SampleCounter::~SampleCounter()
+	{
+		destroy();
+	}
+
+	void SampleCounter::create()
+	{
+		destroy();
+		glGenQueries(QUERY_COUNT, queries);
+	}
+
+	void SampleCounter::destroy()
+	{
+		if (queries[0])
+			glDeleteQueries(QUERY_COUNT, queries);
+		for (int i = 0; i < QUERY_COUNT; i++) {
+			queries[i] = 0;
+			pending[i] = false;
+		}
+	}
+
+	void SampleCounter::begin()
+	{
+		if (pending[current]) {
+			glGetQueryObjectui64v(queries[current], GL_QUERY_RESULT, &lastSamples);
+			pending[current] = false;
+		}
+		glBeginQuery(GL_SAMPLES_PASSED, queries[current]);
+	}
+
+	void SampleCounter::end()
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+		pending[current] = true;
+		current = (current + 1) % QUERY_COUNT;
+		for (int i = 0; i < QUERY_COUNT; i++) {
+			int slot = (current + i) % QUERY_COUNT;
+			if (!pending[slot])
+				continue;
+			GLint available = 0;
+			glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				break;
+			glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &lastSamples);
+			pending[slot] = false;
+		}
+	}
+
+	void Benchmark::addPhase(const std::string& name, Setup setup)
+	{
+		phases.push_back(std::make_pair(name, setup));
+	}
+
+	void Benchmark::beginFrame()
+	{
+		if (active() && frame == 0 && phases[phase].second)
+			phases[phase].second();
+	}
+
+	void Benchmark::record(const std::string& metric, double value)
+	{
+		if (!measuring())
+			return;
+		for (Metric& entry : metrics) {
+			if (entry.name != metric)
+				continue;
+			entry.sum += value;
+			entry.min = value < entry.min ? value : entry.min;
+			entry.max = value > entry.max ? value : entry.max;
+			entry.samples++;
+			return;
+		}
+		Metric entry;
+		entry.name = metric;
+		entry.sum = entry.min = entry.max = value;
+		entry.samples = 1;
+		metrics.push_back(entry);
+	}
+
+	void Benchmark::endFrame()
+	{
+		if (!active())
+			return;
+		if (++frame < warmupFrames + measureFrames)
+			return;
+		report();
+		metrics.clear();
+		frame = 0;
+		phase++;
+	}
+
+	void Benchmark::report()
+	{
+		std::printf("[%s]\n", phases[phase].first.c_str());
+		for (const Metric& entry : metrics) {
+			std::printf("  %-24s avg %9.3f  min %9.3f  max %9.3f  (%d muestras)\n", entry.name.c_str(),
+				entry.sum / entry.samples, entry.min, entry.max, entry.samples);
+		}
+		std::fflush(stdout);
+	}
+
+}
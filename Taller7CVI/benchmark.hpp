@@ -0,0 +1,95 @@
+#pragma once
+#include <GL/glew.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace myopengl {
+
+	// Temporizador de GPU con consultas GL_TIME_ELAPSED. Usa un anillo de
+	// consultas para leer resultados de frames anteriores sin bloquear.
+	// Las consultas de tiempo no se pueden anidar entre sí.
+	class GpuTimer {
+	public:
+		GpuTimer() = default;
+		~GpuTimer();
+		GpuTimer(const GpuTimer&) = delete;
+		GpuTimer& operator=(const GpuTimer&) = delete;
+
+		void create();
+		void destroy();
+		void begin();
+		void end();
+		// Último resultado disponible en milisegundos
+		double milliseconds() const { return lastMs; }
+
+	private:
+		static const int QUERY_COUNT = 4;
+		GLuint queries[QUERY_COUNT] = {};
+		bool pending[QUERY_COUNT] = {};
+		int current = 0;
+		double lastMs = 0.0;
+	};
+
+	// Contador de muestras que pasan la prueba de profundidad (consultas
+	// GL_SAMPLES_PASSED), con el mismo anillo que GpuTimer. Sirve para medir
+	// el overdraw: muestras sombreadas frente a píxeles de la ventana.
+	class SampleCounter {
+	public:
+		SampleCounter() = default;
+		~SampleCounter();
+		SampleCounter(const SampleCounter&) = delete;
+		SampleCounter& operator=(const SampleCounter&) = delete;
+
+		void create();
+		void destroy();
+		void begin();
+		void end();
+		// Último resultado disponible
+		GLuint64 samples() const { return lastSamples; }
+
+	private:
+		static const int QUERY_COUNT = 4;
+		GLuint queries[QUERY_COUNT] = {};
+		bool pending[QUERY_COUNT] = {};
+		int current = 0;
+		GLuint64 lastSamples = 0;
+	};
+
+	// Benchmark por fases para el bucle principal (modo --bench). Cada fase
+	// configura la escena, descarta unos frames de calentamiento y promedia
+	// las métricas registradas durante los frames medidos.
+	class Benchmark {
+	public:
+		typedef std::function<void()> Setup;
+
+		void addPhase(const std::string& name, Setup setup);
+		bool active() const { return phase < (int)phases.size(); }
+		bool measuring() const { return active() && frame >= warmupFrames; }
+
+		void beginFrame();
+		void record(const std::string& metric, double value);
+		void endFrame();
+
+		int warmupFrames = 30;
+		int measureFrames = 200;
+
+	private:
+		struct Metric {
+			std::string name;
+			double sum = 0.0;
+			double min = 0.0;
+			double max = 0.0;
+			int samples = 0;
+		};
+
+		void report();
+
+		std::vector<std::pair<std::string, Setup>> phases;
+		std::vector<Metric> metrics;
+		int phase = 0;
+		int frame = 0;
+	};
+
+}
@@ -0,0 +1,238 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace myopengl {
+
+	static float surfaceArea(const Aabb& box)
+	{
+		glm::vec3 size = glm::max(box.max - box.min, glm::vec3(0.0f));
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	static Aabb merge(const Aabb& a, const Aabb& b)
+	{
+		return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+	}
+
+	void Bvh::clear()
+	{
+		nodes.clear();
+		order.clear();
+		buildAreas.clear();
+		buildCost = 0.0f;
+		treeDepth = 0;
+		refitQuality = BvhQuality();
+	}
+
+	void Bvh::build(const BoundsArray& bounds, int leafSize)
+	{
+		clear();
+		int count = (int)bounds.size();
+		if (count == 0)
+			return;
+		order.resize(count);
+		for (int i = 0; i < count; i++)
+			order[i] = i;
+		nodes.reserve(2 * (count / leafSize + 1));
+		nodes.push_back({ Aabb(), 0, count, -1 });
+
+		// Construcción iterativa: los dos hijos se reservan juntos al dividir,
+		// así quedan contiguos y siempre después de su padre
+		std::vector<std::pair<int, int>> stack; // nodo, nivel
+		stack.push_back(std::make_pair(0, 1));
+		while (!stack.empty()) {
+			int index = stack.back().first;
+			int level = stack.back().second;
+			stack.pop_back();
+			treeDepth = std::max(treeDepth, level);
+			int first = nodes[index].first;
+			int end = first + nodes[index].count;
+
+			Aabb box = bounds.box(order[first]);
+			glm::vec3 centerMin = (box.min + box.max) * 0.5f;
+			glm::vec3 centerMax = centerMin;
+			for (int i = first + 1; i < end; i++) {
+				Aabb primitive = bounds.box(order[i]);
+				box = merge(box, primitive);
+				glm::vec3 center = (primitive.min + primitive.max) * 0.5f;
+				centerMin = glm::min(centerMin, center);
+				centerMax = glm::max(centerMax, center);
+			}
+			nodes[index].bounds = box;
+			if (end - first <= leafSize)
+				continue;
+
+			// Mediana de los centros sobre el eje donde más se reparten
+			glm::vec3 spread = centerMax - centerMin;
+			const std::vector<float>& axis = spread.x >= spread.y && spread.x >= spread.z ? bounds.cx
+				: (spread.y >= spread.z ? bounds.cy : bounds.cz);
+			int middle = first + (end - first) / 2;
+			std::nth_element(order.begin() + first, order.begin() + middle, order.begin() + end,
+				[&axis](int a, int b) { return axis[a] < axis[b]; });
+
+			int left = (int)nodes.size();
+			nodes[index].left = left;
+			nodes.push_back({ Aabb(), first, middle - first, -1 });
+			nodes.push_back({ Aabb(), middle, end - middle, -1 });
+			stack.push_back(std::make_pair(left, level + 1));
+			stack.push_back(std::make_pair(left + 1, level + 1));
+		}
+
+		buildAreas.resize(nodes.size());
+		for (size_t n = 0; n < nodes.size(); n++)
+			buildAreas[n] = surfaceArea(nodes[n].bounds);
+		buildCost = sahCost();
+	}
+
+	void Bvh::refit(const BoundsArray& bounds)
+	{
+		// Los hijos están después del padre: recorrer al revés es de abajo hacia arriba
+		refitQuality.worstInflation = 1.0f;
+		for (int n = (int)nodes.size() - 1; n >= 0; n--) {
+			BvhNode& node = nodes[n];
+			if (node.left < 0) {
+				node.bounds = bounds.box(order[node.first]);
+				for (int i = node.first + 1; i < node.first + node.count; i++)
+					node.bounds = merge(node.bounds, bounds.box(order[i]));
+			}
+			else {
+				node.bounds = merge(nodes[node.left].bounds, nodes[node.left + 1].bounds);
+			}
+			if (buildAreas[n] > 0.0f)
+				refitQuality.worstInflation = std::max(refitQuality.worstInflation, surfaceArea(node.bounds) / buildAreas[n]);
+		}
+		refitQuality.sahRatio = buildCost > 0.0f ? sahCost() / buildCost : 1.0f;
+	}
+
+	// Costo SAH relativo a la raíz: recorrer un nodo cuesta 1 y cada primitiva de una hoja, 1
+	float Bvh::sahCost() const
+	{
+		if (nodes.empty())
+			return 0.0f;
+		float rootArea = std::max(surfaceArea(nodes[0].bounds), 1e-6f);
+		float cost = 0.0f;
+		for (const BvhNode& node : nodes)
+			cost += surfaceArea(node.bounds) / rootArea * (node.left < 0 ? (float)node.count : 1.0f);
+		return cost;
+	}
+
+	// -1: fuera, 1: completamente dentro, 0: cruza algún plano. mask indica
+	// los planos que aún hay que probar y se limpia con los que ya contienen la caja.
+	static int classifyBox(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extent, int& mask)
+	{
+		for (int p = 0; p < 6; p++) {
+			if (!(mask & (1 << p)))
+				continue;
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = std::fabs(plane.x) * extent.x + std::fabs(plane.y) * extent.y + std::fabs(plane.z) * extent.z;
+			if (distance + radius < 0.0f)
+				return -1;
+			if (distance - radius >= 0.0f)
+				mask &= ~(1 << p);
+		}
+		return mask == 0 ? 1 : 0;
+	}
+
+	void Bvh::queryFrustum(const BoundsArray& bounds, const Frustum& frustum, uint8_t* visible) const
+	{
+		if (nodes.empty())
+			return;
+		std::memset(visible, 0, order.size());
+		int stack[64][2]; // nodo, planos pendientes
+		int top = 0;
+		stack[top][0] = 0;
+		stack[top][1] = 0x3F;
+		top++;
+		while (top > 0) {
+			top--;
+			const BvhNode& node = nodes[stack[top][0]];
+			int mask = stack[top][1];
+			glm::vec3 center = (node.bounds.min + node.bounds.max) * 0.5f;
+			glm::vec3 extent = (node.bounds.max - node.bounds.min) * 0.5f;
+			int result = classifyBox(frustum, center, extent, mask);
+			if (result < 0)
+				continue;
+			if (result > 0) {
+				// Todo el subárbol está dentro: no hace falta probar cada objeto
+				for (int i = node.first; i < node.first + node.count; i++)
+					visible[order[i]] = 1;
+				continue;
+			}
+			if (node.left < 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					int primitive = order[i];
+					int primitiveMask = mask;
+					glm::vec3 primitiveCenter(bounds.cx[primitive], bounds.cy[primitive], bounds.cz[primitive]);
+					glm::vec3 primitiveExtent(bounds.ex[primitive], bounds.ey[primitive], bounds.ez[primitive]);
+					visible[primitive] = classifyBox(frustum, primitiveCenter, primitiveExtent, primitiveMask) >= 0 ? 1 : 0;
+				}
+				continue;
+			}
+			stack[top][0] = node.left;
+			stack[top][1] = mask;
+			top++;
+			stack[top][0] = node.left + 1;
+			stack[top][1] = mask;
+			top++;
+		}
+	}
+
+	// Distancia de entrada del rayo a la caja (método de las placas), o -1
+	static float intersectBox(const Aabb& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance)
+	{
+		glm::vec3 t0 = (box.min - origin) * inverseDirection;
+		glm::vec3 t1 = (box.max - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	int Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, const RayTest& test, float& distance) const
+	{
+		int hit = -1;
+		distance = 1e30f;
+		if (nodes.empty())
+			return hit;
+		glm::vec3 inverseDirection = 1.0f / direction;
+		int stack[64];
+		int top = 0;
+		stack[top++] = 0;
+		while (top > 0) {
+			const BvhNode& node = nodes[stack[--top]];
+			if (intersectBox(node.bounds, origin, inverseDirection, distance) < 0.0f)
+				continue;
+			if (node.left < 0) {
+				for (int i = node.first; i < node.first + node.count; i++) {
+					float t = test(order[i], origin, direction);
+					if (t >= 0.0f && t < distance) {
+						distance = t;
+						hit = order[i];
+					}
+				}
+				continue;
+			}
+			// Primero el hijo más cercano (se apila al final)
+			float tLeft = intersectBox(nodes[node.left].bounds, origin, inverseDirection, distance);
+			float tRight = intersectBox(nodes[node.left + 1].bounds, origin, inverseDirection, distance);
+			bool leftFirst = tLeft >= 0.0f && (tRight < 0.0f || tLeft <= tRight);
+			if (leftFirst) {
+				if (tRight >= 0.0f)
+					stack[top++] = node.left + 1;
+				stack[top++] = node.left;
+			}
+			else {
+				if (tLeft >= 0.0f)
+					stack[top++] = node.left;
+				if (tRight >= 0.0f)
+					stack[top++] = node.left + 1;
+			}
+		}
+		return hit;
+	}
+
+}
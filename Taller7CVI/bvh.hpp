@@ -0,0 +1,62 @@
+#pragma once
+#include "culling.hpp"
+#include <functional>
+#include <vector>
+
+namespace myopengl {
+
+	// Nodo de la jerarquía. Los hijos de un nodo interno ocupan left y
+	// left + 1, y siempre están después del padre. Todo nodo cubre un rango
+	// contiguo [first, first + count) del orden de primitivas.
+	struct BvhNode {
+		Aabb bounds;
+		int first;
+		int count;
+		int left; // -1 en las hojas
+	};
+
+	// Calidad del árbol reajustado respecto al construido: costo SAH total
+	// y el peor crecimiento de área de un nodo individual
+	struct BvhQuality {
+		float sahRatio = 1.0f;
+		float worstInflation = 1.0f;
+	};
+
+	// Jerarquía de cajas sobre un BoundsArray. build() la construye desde
+	// cero (división por la mediana del eje más largo); refit() solo
+	// recalcula las cajas con la topología existente, lo que basta mientras
+	// los objetos no se alejen mucho de donde estaban al construirla.
+	class Bvh {
+	public:
+		// Prueba exacta de un rayo contra la primitiva; devuelve la distancia
+		// del impacto o un valor negativo si no hay impacto
+		typedef std::function<float(int primitive, const glm::vec3& origin, const glm::vec3& direction)> RayTest;
+
+		void build(const BoundsArray& bounds, int leafSize = 4);
+		void refit(const BoundsArray& bounds);
+		void clear();
+
+		// visible[i] = 1 para cada primitiva que toca el frustum (el resto a 0).
+		// bounds son las mismas cajas del último build() o refit().
+		void queryFrustum(const BoundsArray& bounds, const Frustum& frustum, uint8_t* visible) const;
+		// Primitiva más cercana que corta el rayo, o -1. distance recibe la distancia.
+		int raycast(const glm::vec3& origin, const glm::vec3& direction, const RayTest& test, float& distance) const;
+
+		const BvhQuality& quality() const { return refitQuality; }
+		int nodeCount() const { return (int)nodes.size(); }
+		int primitiveCount() const { return (int)order.size(); }
+		int depth() const { return treeDepth; }
+		bool empty() const { return nodes.empty(); }
+
+	private:
+		float sahCost() const;
+
+		std::vector<BvhNode> nodes;
+		std::vector<int> order;         // primitivas ordenadas por hoja
+		std::vector<float> buildAreas;  // área de cada nodo al construir
+		float buildCost = 0.0f;
+		int treeDepth = 0;
+		BvhQuality refitQuality;
+	};
+
+}
@@ -0,0 +1,138 @@
+#include "culling.hpp"
+#include <cmath>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MYOPENGL_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace myopengl {
+
+	Aabb computeBounds(const float* vertices, size_t vertexCount, size_t stride)
+	{
+		Aabb box;
+		box.min = box.max = glm::vec3(vertices[0], vertices[1], vertices[2]);
+		for (size_t v = 1; v < vertexCount; v++) {
+			glm::vec3 position(vertices[v * stride], vertices[v * stride + 1], vertices[v * stride + 2]);
+			box.min = glm::min(box.min, position);
+			box.max = glm::max(box.max, position);
+		}
+		return box;
+	}
+
+	void BoundsArray::resize(size_t count)
+	{
+		cx.resize(count);
+		cy.resize(count);
+		cz.resize(count);
+		ex.resize(count);
+		ey.resize(count);
+		ez.resize(count);
+	}
+
+	Aabb BoundsArray::box(size_t index) const
+	{
+		glm::vec3 center(cx[index], cy[index], cz[index]);
+		glm::vec3 extent(ex[index], ey[index], ez[index]);
+		return { center - extent, center + extent };
+	}
+
+	Aabb mergeBounds(const BoundsArray& bounds, size_t first, size_t end)
+	{
+		glm::vec3 boxMin(std::numeric_limits<float>::max());
+		glm::vec3 boxMax(-std::numeric_limits<float>::max());
+		for (size_t i = first; i < end; i++) {
+			glm::vec3 center(bounds.cx[i], bounds.cy[i], bounds.cz[i]);
+			glm::vec3 extent(bounds.ex[i], bounds.ey[i], bounds.ez[i]);
+			boxMin = glm::min(boxMin, center - extent);
+			boxMax = glm::max(boxMax, center + extent);
+		}
+		return { boxMin, boxMax };
+	}
+
+	// Gribb-Hartmann: cada plano es la fila 3 más o menos una de las filas 0-2
+	Frustum extractFrustum(const glm::mat4& m)
+	{
+		glm::vec4 row[4];
+		for (int r = 0; r < 4; r++)
+			row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+		Frustum frustum;
+		frustum.planes[0] = row[3] + row[0]; // izquierdo
+		frustum.planes[1] = row[3] - row[0]; // derecho
+		frustum.planes[2] = row[3] + row[1]; // inferior
+		frustum.planes[3] = row[3] - row[1]; // superior
+		frustum.planes[4] = row[3] + row[2]; // cercano
+		frustum.planes[5] = row[3] - row[2]; // lejano
+		for (glm::vec4& plane : frustum.planes)
+			plane /= glm::length(glm::vec3(plane));
+		return frustum;
+	}
+
+	// Centro transformado y semiextensión |M| * e (caja que contiene la caja girada)
+	void transformBounds(const Aabb& local, const glm::mat4* models, size_t modelStride,
+		size_t first, size_t end, BoundsArray& bounds)
+	{
+		glm::vec3 center = (local.min + local.max) * 0.5f;
+		glm::vec3 extent = (local.max - local.min) * 0.5f;
+		for (size_t i = first; i < end; i++) {
+			const glm::mat4& m = *(const glm::mat4*)((const char*)models + modelStride * i);
+			glm::vec4 c = m * glm::vec4(center, 1.0f);
+			bounds.cx[i] = c.x;
+			bounds.cy[i] = c.y;
+			bounds.cz[i] = c.z;
+			bounds.ex[i] = std::fabs(m[0][0]) * extent.x + std::fabs(m[1][0]) * extent.y + std::fabs(m[2][0]) * extent.z;
+			bounds.ey[i] = std::fabs(m[0][1]) * extent.x + std::fabs(m[1][1]) * extent.y + std::fabs(m[2][1]) * extent.z;
+			bounds.ez[i] = std::fabs(m[0][2]) * extent.x + std::fabs(m[1][2]) * extent.y + std::fabs(m[2][2]) * extent.z;
+		}
+	}
+
+	// Una caja queda fuera de un frustum si, para algún plano, n·c + w + |n|·e < 0
+	void cullBounds(const BoundsArray& bounds, size_t first, size_t end,
+		const Frustum* frusta, int frustumCount, uint8_t* visible)
+	{
+		size_t i = first;
+#ifdef MYOPENGL_SSE
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= end; i += 4) {
+			__m128 cx = _mm_loadu_ps(&bounds.cx[i]), cy = _mm_loadu_ps(&bounds.cy[i]), cz = _mm_loadu_ps(&bounds.cz[i]);
+			__m128 ex = _mm_loadu_ps(&bounds.ex[i]), ey = _mm_loadu_ps(&bounds.ey[i]), ez = _mm_loadu_ps(&bounds.ez[i]);
+			int masks[4] = { 0, 0, 0, 0 };
+			for (int f = 0; f < frustumCount; f++) {
+				__m128 outside = zero;
+				for (const glm::vec4& plane : frusta[f].planes) {
+					__m128 distance = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+						_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+					__m128 radius = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+						_mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+				}
+				int inside = ~_mm_movemask_ps(outside);
+				for (int k = 0; k < 4; k++)
+					masks[k] |= ((inside >> k) & 1) << f;
+			}
+			for (int k = 0; k < 4; k++)
+				visible[i + k] = (uint8_t)masks[k];
+		}
+#endif
+		for (; i < end; i++) {
+			int mask = 0;
+			for (int f = 0; f < frustumCount; f++) {
+				bool inside = true;
+				for (const glm::vec4& plane : frusta[f].planes) {
+					float distance = plane.x * bounds.cx[i] + plane.y * bounds.cy[i] + plane.z * bounds.cz[i] + plane.w;
+					float radius = std::fabs(plane.x) * bounds.ex[i] + std::fabs(plane.y) * bounds.ey[i] + std::fabs(plane.z) * bounds.ez[i];
+					if (distance + radius < 0.0f) {
+						inside = false;
+						break;
+					}
+				}
+				mask |= (inside ? 1 : 0) << f;
+			}
+			visible[i] = (uint8_t)mask;
+		}
+	}
+
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Caja alineada a los ejes
+	struct Aabb {
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	// Caja local a partir de posiciones intercaladas (stride en floats)
+	Aabb computeBounds(const float* vertices, size_t vertexCount, size_t stride);
+
+	// Cajas de mundo en estructura de arreglos (centro y semiextensión),
+	// para probar cuatro objetos por instrucción SSE
+	struct BoundsArray {
+		std::vector<float> cx, cy, cz;
+		std::vector<float> ex, ey, ez;
+
+		void resize(size_t count);
+		size_t size() const { return cx.size(); }
+		Aabb box(size_t index) const;
+	};
+
+	// Caja que contiene las cajas [first, end); si el rango está vacío
+	// devuelve la caja invertida (min = +inf, max = -inf)
+	Aabb mergeBounds(const BoundsArray& bounds, size_t first, size_t end);
+
+	// Seis planos (normal hacia adentro, w = distancia) extraídos de una
+	// matriz de vista-proyección; sirve para perspectiva y ortográfica
+	struct Frustum {
+		glm::vec4 planes[6];
+	};
+
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+
+	// Transforma la caja local por las matrices de modelo [first, end) y guarda
+	// la caja de mundo que la contiene en bounds (mismo índice)
+	void transformBounds(const Aabb& local, const glm::mat4* models, size_t modelStride,
+		size_t first, size_t end, BoundsArray& bounds);
+
+	// visible[i] = máscara de bits de los frustums que toca la caja i (bit f
+	// para frusta[f], p. ej. las cascadas de sombra), para i en [first, end).
+	// Con un solo frustum queda 1 si es visible y 0 si no.
+	void cullBounds(const BoundsArray& bounds, size_t first, size_t end,
+		const Frustum* frusta, int frustumCount, uint8_t* visible);
+
+	inline void cullBounds(const BoundsArray& bounds, size_t first, size_t end,
+		const Frustum& frustum, uint8_t* visible)
+	{
+		cullBounds(bounds, first, end, &frustum, 1, visible);
+	}
+
+}
@@ -0,0 +1,79 @@
+#include "gbuffer.hpp"
+#include <iostream>
+
+namespace myopengl {
+
+	GBuffer::~GBuffer()
+	{
+		destroy();
+	}
+
+	static GLuint createTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height)
+	{
+		// Se leen con texelFetch: sin filtrado ni mipmaps
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+
+	bool GBuffer::create(int width, int height)
+	{
+		destroy();
+		bufferWidth = width;
+		bufferHeight = height;
+		albedoTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+		normalTexture = createTarget(GL_RG16F, GL_RG, GL_HALF_FLOAT, width, height);
+		depthTexture = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+		const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, drawBuffers);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error al crear el G-buffer: 0x" << std::hex << status << std::dec << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void GBuffer::bindTextures(GLuint firstUnit) const
+	{
+		const GLuint targets[3] = { albedoTexture, normalTexture, depthTexture };
+		for (int i = 0; i < 3; i++) {
+			glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+			glBindTexture(GL_TEXTURE_2D, targets[i]);
+			glBindSampler(firstUnit + i, 0);
+		}
+	}
+
+	void GBuffer::destroy()
+	{
+		if (fbo)
+			glDeleteFramebuffers(1, &fbo);
+		if (albedoTexture)
+			glDeleteTextures(1, &albedoTexture);
+		if (normalTexture)
+			glDeleteTextures(1, &normalTexture);
+		if (depthTexture)
+			glDeleteTextures(1, &depthTexture);
+		fbo = 0;
+		albedoTexture = 0;
+		normalTexture = 0;
+		depthTexture = 0;
+		bufferWidth = 0;
+		bufferHeight = 0;
+	}
+
+}
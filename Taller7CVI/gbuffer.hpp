@@ -0,0 +1,36 @@
+#pragma once
+#include <GL/glew.h>
+
+namespace myopengl {
+
+	// G-buffer compacto para el renderizado diferido: color base (RGBA8),
+	// normal en proyección octaédrica (RG16F) y profundidad (24 bits), de
+	// la que el shader de iluminación reconstruye la posición: 12 bytes por
+	// píxel, sin guardar la posición aparte.
+	class GBuffer {
+	public:
+		GBuffer() = default;
+		~GBuffer();
+		GBuffer(const GBuffer&) = delete;
+		GBuffer& operator=(const GBuffer&) = delete;
+
+		bool create(int width, int height);
+		void destroy();
+
+		// Vincula color base, normal y profundidad a firstUnit, +1 y +2
+		void bindTextures(GLuint firstUnit) const;
+
+		GLuint framebuffer() const { return fbo; }
+		int width() const { return bufferWidth; }
+		int height() const { return bufferHeight; }
+
+	private:
+		GLuint albedoTexture = 0;
+		GLuint normalTexture = 0;
+		GLuint depthTexture = 0;
+		GLuint fbo = 0;
+		int bufferWidth = 0;
+		int bufferHeight = 0;
+	};
+
+}
@@ -0,0 +1,376 @@
+#include "hiz_culling.hpp"
+#include <algorithm>
+
+namespace myopengl {
+
+	// Triángulo que cubre el nivel de destino
+	static const char* reduceVertexSource = R"(
+#version 330 core
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	// Cada texel guarda la profundidad más lejana de su bloque 2x2 del nivel
+	// anterior; si la fuente tiene tamaño impar, el último texel también
+	// cubre la fila o columna sobrante (bloque de hasta 3x3)
+	static const char* reduceFragmentSource = R"(
+#version 330 core
+out float MaxDepth;
+uniform sampler2D source; // solo el nivel anterior es accesible (nivel base)
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(source, 0) - 1;
+    ivec2 first = min(texel * 2, last);
+    ivec2 end = min(texel * 2 + 1, last);
+    if(end.x + 1 == last.x) end.x = last.x;
+    if(end.y + 1 == last.y) end.y = last.y;
+    float depth = 0.0;
+    for(int y = first.y; y <= end.y; y++)
+        for(int x = first.x; x <= end.x; x++)
+            depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+    MaxDepth = depth;
+}
+)";
+
+	// Una invocación por instancia: prueba la caja contra la pirámide y
+	// marca si la instancia es visible
+	static const char* cullComputeSource = R"(
+#version 430 core
+layout (local_size_x = 64) in;
+layout (std430, binding = 5) readonly buffer Instances { vec4 instances[]; };
+layout (std430, binding = 8) writeonly buffer Visibility { uint visibility[]; };
+uniform sampler2D hiz;
+uniform mat4 viewProjection; // la del frame de la pirámide
+uniform vec3 boundsMin;      // caja local de la malla
+uniform vec3 boundsMax;
+uniform int firstVec4;       // primera instancia, en vec4 desde el inicio del rango
+uniform int stride;          // vec4 por instancia
+uniform int count;
+uniform int hasPyramid;
+
+bool occluded(mat4 model)
+{
+    if(hasPyramid == 0)
+        return false;
+    vec3 ndcMin = vec3(1e30);
+    vec3 ndcMax = vec3(-1e30);
+    for(int c = 0; c < 8; c++) {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+        vec4 clip = viewProjection * (model * vec4(corner, 1.0));
+        // Cruza el plano de la cámara: no se puede proyectar, se dibuja
+        if(clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = min(ndcMin, ndc);
+        ndcMax = max(ndcMax, ndc);
+    }
+    // Fuera de la pantalla del frame anterior: sin datos, se dibuja
+    // (el frustum de este frame ya descartó lo que no se ve)
+    if(any(lessThan(ndcMin.xy, vec2(-1.0))) || any(greaterThan(ndcMax.xy, vec2(1.0))))
+        return false;
+    float nearestDepth = ndcMin.z * 0.5 + 0.5;
+    vec2 uvMin = ndcMin.xy * 0.5 + 0.5;
+    vec2 uvMax = ndcMax.xy * 0.5 + 0.5;
+
+    // Nivel donde la caja mide a lo sumo un texel; se suma un texel de
+    // margen por lado porque los niveles impares no se reducen exacto a la mitad
+    vec2 extent = (uvMax - uvMin) * vec2(textureSize(hiz, 0));
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, textureQueryLevels(hiz) - 1);
+    ivec2 levelSize = textureSize(hiz, level);
+    ivec2 first = clamp(ivec2(uvMin * vec2(levelSize)) - 1, ivec2(0), levelSize - 1);
+    ivec2 last = clamp(ivec2(uvMax * vec2(levelSize)) + 1, ivec2(0), levelSize - 1);
+    float farthest = 0.0;
+    for(int y = first.y; y <= last.y; y++)
+        for(int x = first.x; x <= last.x; x++)
+            farthest = max(farthest, texelFetch(hiz, ivec2(x, y), level).r);
+    return nearestDepth > farthest;
+}
+
+void main()
+{
+    int index = int(gl_GlobalInvocationID.x);
+    if(index >= count)
+        return;
+    int source = firstVec4 + index * stride;
+    mat4 model = mat4(instances[source], instances[source + 1], instances[source + 2], instances[source + 3]);
+    visibility[index] = occluded(model) ? 0u : 1u;
+}
+)";
+
+	// Un solo grupo recorre las marcas en bloques de 1024 con una suma
+	// prefija en memoria compartida: las visibles se copian en el mismo
+	// orden en que llegaron (de adelante hacia atrás si se ordenaron)
+	static const char* compactComputeSource = R"(
+#version 430 core
+layout (local_size_x = 1024) in;
+layout (std430, binding = 5) readonly buffer Instances { vec4 instances[]; };
+layout (std430, binding = 6) writeonly buffer VisibleInstances { vec4 visibleInstances[]; };
+layout (std430, binding = 7) buffer DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+layout (std430, binding = 8) readonly buffer Visibility { uint visibility[]; };
+uniform int firstVec4;
+uniform int stride;
+uniform int count;
+
+shared uint prefix[1024];
+
+void main()
+{
+    uint local = gl_LocalInvocationID.x;
+    uint base = 0u;
+    for(int block = 0; block < count; block += 1024) {
+        int index = block + int(local);
+        uint flag = index < count ? visibility[index] : 0u;
+        prefix[local] = flag;
+        barrier();
+        // Suma prefija inclusiva (Hillis-Steele)
+        for(uint span = 1u; span < 1024u; span <<= 1) {
+            uint value = local >= span ? prefix[local - span] : 0u;
+            barrier();
+            prefix[local] += value;
+            barrier();
+        }
+        if(flag != 0u) {
+            int slot = int(base + prefix[local] - 1u);
+            int source = firstVec4 + index * stride;
+            for(int i = 0; i < stride; i++)
+                visibleInstances[slot * stride + i] = instances[source + i];
+        }
+        base += prefix[1023];
+        barrier();
+    }
+    if(local == 0u)
+        instanceCount = base;
+}
+)";
+
+	HiZCulling::~HiZCulling()
+	{
+		destroy();
+	}
+
+	bool HiZCulling::create()
+	{
+		destroy();
+		if (!reduceProgram.build(reduceVertexSource, reduceFragmentSource, "de reducción Hi-Z")
+			|| !cullProgram.buildCompute(cullComputeSource, "de culling por oclusión")
+			|| !compactProgram.buildCompute(compactComputeSource, "de compactación de instancias"))
+			return false;
+		reduceProgram.use();
+		reduceProgram.uniform<int>("source").set(0);
+		cullViewProjection = cullProgram.uniform<glm::mat4>("viewProjection");
+		cullBoundsMin = cullProgram.uniform<glm::vec3>("boundsMin");
+		cullBoundsMax = cullProgram.uniform<glm::vec3>("boundsMax");
+		cullFirstVec4 = cullProgram.uniform<int>("firstVec4");
+		cullStride = cullProgram.uniform<int>("stride");
+		cullCount = cullProgram.uniform<int>("count");
+		cullHasPyramid = cullProgram.uniform<int>("hasPyramid");
+		compactFirstVec4 = compactProgram.uniform<int>("firstVec4");
+		compactStride = compactProgram.uniform<int>("stride");
+		compactCount = compactProgram.uniform<int>("count");
+		cullProgram.use();
+		cullProgram.uniform<int>("hiz").set(0);
+
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		glGenVertexArrays(1, &emptyVao);
+		glGenFramebuffers(1, &fbo);
+		glGenBuffers(1, &visible);
+		glGenBuffers(1, &visibility);
+		glGenBuffers(COMMAND_COUNT, commands);
+		for (int i = 0; i < COMMAND_COUNT; i++) {
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands[i]);
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		buildTimer.create();
+		cullTimer.create();
+		return true;
+	}
+
+	void HiZCulling::destroy()
+	{
+		if (depthTexture)
+			glDeleteTextures(1, &depthTexture);
+		if (hizTexture)
+			glDeleteTextures(1, &hizTexture);
+		if (fbo)
+			glDeleteFramebuffers(1, &fbo);
+		if (emptyVao)
+			glDeleteVertexArrays(1, &emptyVao);
+		if (visible)
+			glDeleteBuffers(1, &visible);
+		if (visibility)
+			glDeleteBuffers(1, &visibility);
+		if (commands[0])
+			glDeleteBuffers(COMMAND_COUNT, commands);
+		reduceProgram.destroy();
+		cullProgram.destroy();
+		compactProgram.destroy();
+		buildTimer.destroy();
+		cullTimer.destroy();
+		depthTexture = 0;
+		hizTexture = 0;
+		fbo = 0;
+		emptyVao = 0;
+		visible = 0;
+		visibility = 0;
+		for (int i = 0; i < COMMAND_COUNT; i++) {
+			commands[i] = 0;
+			commandPending[i] = false;
+		}
+		visibleCapacity = 0;
+		depthWidth = 0;
+		depthHeight = 0;
+		levels = 0;
+		hasPyramid = false;
+	}
+
+	void HiZCulling::capture(GLuint framebuffer, int width, int height, const glm::mat4& viewProjection)
+	{
+		if (!fbo || width < 2 || height < 2)
+			return;
+		buildTimer.begin();
+		if (width != depthWidth || height != depthHeight) {
+			depthWidth = width;
+			depthHeight = height;
+			if (depthTexture)
+				glDeleteTextures(1, &depthTexture);
+			if (hizTexture)
+				glDeleteTextures(1, &hizTexture);
+			glGenTextures(1, &depthTexture);
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+			// Nivel 0 a media resolución; cada nivel siguiente, la mitad (piso)
+			int baseWidth = width / 2, baseHeight = height / 2;
+			levels = 1;
+			while ((baseWidth >> levels) > 0 || (baseHeight >> levels) > 0)
+				levels++;
+			glGenTextures(1, &hizTexture);
+			glBindTexture(GL_TEXTURE_2D, hizTexture);
+			for (int level = 0; level < levels; level++)
+				glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(baseWidth >> level, 1),
+					std::max(baseHeight >> level, 1), 0, GL_RED, GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		}
+
+		// La copia convierte el formato de profundidad de la ventana al de la textura
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(emptyVao);
+		reduceProgram.use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindSampler(0, 0);
+		for (int level = 0; level < levels; level++) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hizTexture, level);
+			glViewport(0, 0, std::max((width / 2) >> level, 1), std::max((height / 2) >> level, 1));
+			if (level == 0) {
+				glBindTexture(GL_TEXTURE_2D, depthTexture);
+			}
+			else {
+				// Solo el nivel anterior queda visible al muestreo (y es el
+				// nivel 0 para texelFetch): no hay lazo de realimentación
+				// con el nivel que se escribe
+				glBindTexture(GL_TEXTURE_2D, hizTexture);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			}
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		glBindTexture(GL_TEXTURE_2D, hizTexture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glEnable(GL_DEPTH_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		pyramidViewProjection = viewProjection;
+		hasPyramid = true;
+		buildTimer.end();
+		frameStats.buildMs = buildTimer.milliseconds();
+	}
+
+	void HiZCulling::cull(GLuint instanceBuffer, GLintptr offset, int count, GLsizeiptr stride,
+		const Aabb& localBounds, const MeshRange& mesh)
+	{
+		if (!visible)
+			return;
+		current = (current + 1) % COMMAND_COUNT;
+		GLuint command = commands[current];
+		// Resultado de hace COMMAND_COUNT frames (ya terminado)
+		if (commandPending[current]) {
+			DrawElementsIndirectCommand done;
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command);
+			glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(done), &done);
+			frameStats.tested = commandTested[current];
+			frameStats.visible = (int)done.instanceCount;
+		}
+		DrawElementsIndirectCommand reset = mesh.command(0, 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command);
+		glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(reset), &reset);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		commandTested[current] = count;
+		commandPending[current] = true;
+		if (count <= 0)
+			return;
+
+		GLsizeiptr needed = count * stride;
+		if (needed > visibleCapacity) {
+			visibleCapacity = needed;
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, visible);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, visibleCapacity, NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibility);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+
+		cullTimer.begin();
+		// El rango del SSBO debe empezar alineado: el resto se pasa en vec4
+		GLintptr alignedOffset = offset / storageAlignment * storageAlignment;
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, INSTANCES_BINDING, instanceBuffer, alignedOffset,
+			offset - alignedOffset + needed);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visible, 0, needed);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, command);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, VISIBILITY_BINDING, visibility, 0, count * sizeof(GLuint));
+		int firstVec4 = (int)((offset - alignedOffset) / sizeof(glm::vec4));
+		int strideVec4 = (int)(stride / sizeof(glm::vec4));
+		cullProgram.use();
+		cullViewProjection.set(pyramidViewProjection);
+		cullBoundsMin.set(localBounds.min);
+		cullBoundsMax.set(localBounds.max);
+		cullFirstVec4.set(firstVec4);
+		cullStride.set(strideVec4);
+		cullCount.set(count);
+		cullHasPyramid.set(hasPyramid ? 1 : 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, hizTexture);
+		glBindSampler(0, 0);
+		glDispatchCompute((count + 63) / 64, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		compactProgram.use();
+		compactFirstVec4.set(firstVec4);
+		compactStride.set(strideVec4);
+		compactCount.set(count);
+		glDispatchCompute(1, 1, 1);
+		// El dibujo lee el comando y las instancias escritos por el shader
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+		cullTimer.end();
+		frameStats.cullMs = cullTimer.milliseconds();
+	}
+
+}
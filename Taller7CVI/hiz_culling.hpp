@@ -0,0 +1,97 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader_program.hpp"
+#include "benchmark.hpp"
+#include "culling.hpp"
+#include "mesh.hpp"
+
+namespace myopengl {
+
+	struct OcclusionStats {
+		int tested = 0;       // instancias probadas (de un frame reciente)
+		int visible = 0;      // instancias que pasaron la prueba en ese frame
+		double buildMs = 0.0; // copia de profundidad + pirámide (GPU)
+		double cullMs = 0.0;  // prueba de las cajas (GPU)
+	};
+
+	// Culling por oclusión en la GPU con un Hi-Z: la profundidad del frame
+	// anterior se reduce a una pirámide donde cada texel guarda la
+	// profundidad más lejana de su bloque. Un compute shader proyecta la
+	// caja de cada instancia con la vista-proyección de ese frame, elige el
+	// nivel donde la caja cubre pocos texels y la descarta si queda detrás
+	// de todos. Las instancias que pasan se compactan, en su orden
+	// original, en un buffer de instancias y su cantidad va al comando de
+	// dibujo indirecto, así que la CPU no lee resultados. Necesita GL 4.3
+	// (compute shaders y SSBO).
+	//
+	// Al usar la profundidad del frame anterior, lo que acaba de quedar a la
+	// vista (cámara u objetos en movimiento) puede faltar durante un frame.
+	class HiZCulling {
+	public:
+		static const GLuint INSTANCES_BINDING = 5;
+		static const GLuint VISIBLE_BINDING = 6;
+		static const GLuint COMMAND_BINDING = 7;
+		static const GLuint VISIBILITY_BINDING = 8;
+
+		HiZCulling() = default;
+		~HiZCulling();
+		HiZCulling(const HiZCulling&) = delete;
+		HiZCulling& operator=(const HiZCulling&) = delete;
+
+		bool create();
+		void destroy();
+
+		// Copia la profundidad del framebuffer indicado (0 = ventana) y
+		// construye la pirámide. viewProjection es la del frame dibujado.
+		void capture(GLuint framebuffer, int width, int height, const glm::mat4& viewProjection);
+		// Olvida la pirámide (p. ej. al cambiar de escena): todo pasa
+		void invalidate() { hasPyramid = false; }
+
+		// Prueba count instancias de stride bytes que empiezan en offset
+		// dentro de instanceBuffer (la matriz de modelo va primero). La caja
+		// local y la malla (rango de índices) son las mismas para todas.
+		// Deja listos visibleBuffer() y commandBuffer() para glDrawElementsIndirect;
+		// con count <= 0 visibleBuffer() puede no tener memoria.
+		void cull(GLuint instanceBuffer, GLintptr offset, int count, GLsizeiptr stride,
+			const Aabb& localBounds, const MeshRange& mesh);
+
+		GLuint visibleBuffer() const { return visible; }
+		GLuint commandBuffer() const { return commands[current]; }
+		const OcclusionStats& stats() const { return frameStats; }
+
+	private:
+		// Anillo de comandos: la cantidad visible se lee del que se va a
+		// reutilizar, escrito hace COMMAND_COUNT frames (sin esperar a la GPU)
+		static const int COMMAND_COUNT = 3;
+
+		ShaderProgram reduceProgram;
+		ShaderProgram cullProgram;
+		ShaderProgram compactProgram;
+		Uniform<glm::mat4> cullViewProjection;
+		Uniform<glm::vec3> cullBoundsMin, cullBoundsMax;
+		Uniform<int> cullFirstVec4, cullStride, cullCount, cullHasPyramid;
+		Uniform<int> compactFirstVec4, compactStride, compactCount;
+
+		GLuint depthTexture = 0; // copia de la profundidad (resolución completa)
+		GLuint hizTexture = 0;   // R32F, nivel 0 a media resolución
+		GLuint fbo = 0;
+		GLuint emptyVao = 0;
+		GLuint visible = 0;
+		GLuint visibility = 0;   // una marca por instancia probada
+		GLuint commands[COMMAND_COUNT] = {};
+		int commandTested[COMMAND_COUNT] = {};
+		bool commandPending[COMMAND_COUNT] = {};
+		int current = 0;
+		GLsizeiptr visibleCapacity = 0;
+		GLint storageAlignment = 256;
+		int depthWidth = 0, depthHeight = 0;
+		int levels = 0;
+		bool hasPyramid = false;
+		glm::mat4 pyramidViewProjection = glm::mat4(1.0f);
+
+		GpuTimer buildTimer, cullTimer;
+		OcclusionStats frameStats;
+	};
+
+}
@@ -0,0 +1,206 @@
+#include "ktx2.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+		const size_t HEADER_SIZE = 80;  // identificador + cabecera + índice
+		const size_t LEVEL_INDEX_SIZE = 24;
+
+		struct FormatInfo {
+			uint32_t format;
+			GLenum glFormat;
+			uint32_t blockBytes;   // cada bloque cubre 4x4 texels
+			uint8_t colorModel;    // modelo del descriptor de datos (DFD)
+			uint8_t channelType;
+		};
+
+		const FormatInfo FORMATS[] = {
+			{ KTX2_BC1_RGB_UNORM, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, 128, 0 },
+			{ KTX2_BC1_RGBA_UNORM, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8, 128, 15 },
+			{ KTX2_BC7_UNORM, GL_COMPRESSED_RGBA_BPTC_UNORM, 16, 130, 0 },
+			{ KTX2_ETC2_RGB8_UNORM, GL_COMPRESSED_RGB8_ETC2, 8, 161, 2 }
+		};
+
+		const FormatInfo* findFormat(uint32_t format)
+		{
+			for (const FormatInfo& info : FORMATS) {
+				if (info.format == format)
+					return &info;
+			}
+			return nullptr;
+		}
+
+		uint32_t read32(const unsigned char* data)
+		{
+			uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		uint64_t read64(const unsigned char* data)
+		{
+			uint64_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		void write32(std::vector<unsigned char>& out, uint32_t value)
+		{
+			for (int i = 0; i < 4; i++)
+				out.push_back((unsigned char)(value >> (8 * i)));
+		}
+
+		void write64(std::vector<unsigned char>& out, uint64_t value)
+		{
+			for (int i = 0; i < 8; i++)
+				out.push_back((unsigned char)(value >> (8 * i)));
+		}
+
+		size_t levelBytes(const FormatInfo& info, int width, int height)
+		{
+			return (size_t)((width + 3) / 4) * ((height + 3) / 4) * info.blockBytes;
+		}
+
+	}
+
+	bool parseKtx2(const unsigned char* data, size_t size, Ktx2Image& image)
+	{
+		if (size < HEADER_SIZE || memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+			return false;
+		uint32_t format = read32(data + 12);
+		uint32_t width = read32(data + 20), height = read32(data + 24), depth = read32(data + 28);
+		uint32_t layers = read32(data + 32), faces = read32(data + 36);
+		uint32_t levelCount = read32(data + 40), supercompression = read32(data + 44);
+		const FormatInfo* info = findFormat(format);
+		// Solo texturas 2D simples, con la cadena de mipmaps ya guardada
+		if (!info || width == 0 || height == 0 || depth != 0 || layers != 0 || faces != 1
+			|| levelCount == 0 || supercompression != 0)
+			return false;
+		// No más niveles que la cadena completa (floor(log2(max(w, h))) + 1):
+		// además, desplazar 32 bits o más no está definido
+		uint32_t maxLevels = 1;
+		while (maxLevels < 32 && (std::max(width, height) >> maxLevels) > 0)
+			maxLevels++;
+		if (levelCount > maxLevels)
+			return false;
+		if (size < HEADER_SIZE + levelCount * LEVEL_INDEX_SIZE)
+			return false;
+
+		image.format = format;
+		image.glFormat = info->glFormat;
+		image.width = (int)width;
+		image.height = (int)height;
+		image.levels.clear();
+		for (uint32_t level = 0; level < levelCount; level++) {
+			const unsigned char* entry = data + HEADER_SIZE + level * LEVEL_INDEX_SIZE;
+			Ktx2Level view;
+			view.offset = (size_t)read64(entry);
+			view.size = (size_t)read64(entry + 8);
+			view.width = std::max(1, (int)(width >> level));
+			view.height = std::max(1, (int)(height >> level));
+			if (view.offset > size || view.size > size - view.offset
+				|| view.size != levelBytes(*info, view.width, view.height))
+				return false;
+			image.levels.push_back(view);
+		}
+		return true;
+	}
+
+	bool writeKtx2(const std::string& path, uint32_t format, int width, int height,
+		const std::vector<std::vector<unsigned char>>& levels)
+	{
+		const FormatInfo* info = findFormat(format);
+		if (!info || levels.empty())
+			return false;
+		uint32_t levelCount = (uint32_t)levels.size();
+
+		// Descriptor de formato: un bloque básico con una sola muestra
+		std::vector<unsigned char> dfd;
+		write32(dfd, 44);                         // tamaño total
+		write32(dfd, 0);                          // vendor Khronos, tipo básico
+		write32(dfd, 2 | (40u << 16));            // versión 2, 40 bytes de bloque
+		dfd.push_back(info->colorModel);
+		dfd.push_back(1);                         // primarios BT.709
+		dfd.push_back(1);                         // transferencia lineal
+		dfd.push_back(0);
+		dfd.push_back(3); dfd.push_back(3);       // bloques de 4x4 (valor - 1)
+		dfd.push_back(0); dfd.push_back(0);
+		dfd.push_back((unsigned char)info->blockBytes);
+		for (int i = 0; i < 7; i++)
+			dfd.push_back(0);
+		write32(dfd, (uint32_t)(info->blockBytes * 8 - 1) << 16 | (uint32_t)info->channelType << 24);
+		write32(dfd, 0);
+		write32(dfd, 0);
+		write32(dfd, 0xFFFFFFFFu);
+
+		size_t dfdOffset = HEADER_SIZE + levelCount * LEVEL_INDEX_SIZE;
+		// Los datos van alineados al bloque, del nivel más chico al más grande
+		size_t alignment = info->blockBytes;
+		std::vector<size_t> offsets(levelCount);
+		size_t offset = dfdOffset + dfd.size();
+		for (int level = (int)levelCount - 1; level >= 0; level--) {
+			offset = (offset + alignment - 1) / alignment * alignment;
+			offsets[level] = offset;
+			offset += levels[level].size();
+		}
+
+		std::vector<unsigned char> header(KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+		write32(header, format);
+		write32(header, 1);                       // typeSize de formatos en bloques
+		write32(header, (uint32_t)width);
+		write32(header, (uint32_t)height);
+		write32(header, 0);                       // profundidad
+		write32(header, 0);                       // capas
+		write32(header, 1);                       // caras
+		write32(header, levelCount);
+		write32(header, 0);                       // sin supercompresión
+		write32(header, (uint32_t)dfdOffset);
+		write32(header, (uint32_t)dfd.size());
+		write32(header, 0);                       // sin pares clave/valor
+		write32(header, 0);
+		write64(header, 0);                       // sin datos globales
+		write64(header, 0);
+		for (uint32_t level = 0; level < levelCount; level++) {
+			write64(header, offsets[level]);
+			write64(header, levels[level].size());
+			write64(header, levels[level].size());
+		}
+		header.insert(header.end(), dfd.begin(), dfd.end());
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) {
+			std::cout << "Error al crear " << path << std::endl;
+			return false;
+		}
+		file.write((const char*)header.data(), header.size());
+		size_t written = header.size();
+		for (int level = (int)levelCount - 1; level >= 0; level--) {
+			static const char padding[16] = {};
+			file.write(padding, offsets[level] - written);
+			file.write((const char*)levels[level].data(), levels[level].size());
+			written = offsets[level] + levels[level].size();
+		}
+		return (bool)file;
+	}
+
+	bool ktx2FormatSupported(uint32_t format)
+	{
+		switch (format) {
+		case KTX2_BC1_RGB_UNORM:
+		case KTX2_BC1_RGBA_UNORM:
+			return GLEW_EXT_texture_compression_s3tc != 0;
+		case KTX2_BC7_UNORM:
+			return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+		case KTX2_ETC2_RGB8_UNORM:
+			return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	// Formatos de Vulkan (vkFormat) que entiende el lector
+	enum Ktx2Format : uint32_t {
+		KTX2_BC1_RGB_UNORM = 131,
+		KTX2_BC1_RGBA_UNORM = 133,
+		KTX2_BC7_UNORM = 145,
+		KTX2_ETC2_RGB8_UNORM = 147
+	};
+
+	struct Ktx2Level {
+		size_t offset = 0;   // desde el inicio del archivo
+		size_t size = 0;
+		int width = 0, height = 0;
+	};
+
+	// Vista de un contenedor KTX2 sin supercompresión: los niveles apuntan
+	// a los bytes del archivo, que tiene que seguir abierto.
+	struct Ktx2Image {
+		uint32_t format = 0;
+		GLenum glFormat = 0;     // 0 si el formato no está soportado
+		int width = 0, height = 0;
+		std::vector<Ktx2Level> levels; // 0 = resolución completa
+	};
+
+	// Valida la cabecera y los rangos de los niveles
+	bool parseKtx2(const unsigned char* data, size_t size, Ktx2Image& image);
+
+	// Escribe un KTX2 2D con bloques comprimidos de 4x4; levels[0] es la
+	// resolución completa. Los niveles se guardan del más chico al más
+	// grande, como pide el formato.
+	bool writeKtx2(const std::string& path, uint32_t format, int width, int height,
+		const std::vector<std::vector<unsigned char>>& levels);
+
+	// Si el contexto actual puede subir ese formato
+	bool ktx2FormatSupported(uint32_t format);
+
+}
@@ -0,0 +1,229 @@
+#include "light_clusters.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <initializer_list>
+
+namespace myopengl {
+
+	LightClusters::~LightClusters()
+	{
+		destroy();
+	}
+
+	void LightClusters::create(bool storageBuffers)
+	{
+		destroy();
+		useStorage = storageBuffers;
+		glGenBuffers(3, buffers);
+		if (useStorage)
+			return;
+		// Sin SSBO: cada lista se lee como textura de buffer
+		const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		glGenTextures(3, textures);
+		for (int i = 0; i < 3; i++) {
+			glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+		}
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void LightClusters::destroy()
+	{
+		if (buffers[0])
+			glDeleteBuffers(3, buffers);
+		if (textures[0])
+			glDeleteTextures(3, textures);
+		for (int i = 0; i < 3; i++) {
+			buffers[i] = 0;
+			textures[i] = 0;
+		}
+	}
+
+	void LightClusters::setProjection(const glm::mat4& projection, float nearPlane, float farPlane)
+	{
+		if (projection == clusterProjection && nearPlane == nearDepth && farPlane == farDepth)
+			return;
+		clusterProjection = projection;
+		nearDepth = nearPlane;
+		farDepth = farPlane;
+		float logRatio = std::log(farPlane / nearPlane);
+		sliceScale = CLUSTER_Z / logRatio;
+		sliceBias = -CLUSTER_Z * std::log(nearPlane) / logRatio;
+
+		// Caja de vista de cada cluster: las esquinas del mosaico en el plano
+		// cercano, escaladas a las profundidades de la rebanada
+		glm::mat4 inverseProjection = glm::inverse(projection);
+		for (int z = 0; z < CLUSTER_Z; z++) {
+			float sliceNear = nearPlane * std::pow(farPlane / nearPlane, z / (float)CLUSTER_Z);
+			float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (z + 1) / (float)CLUSTER_Z);
+			for (int y = 0; y < CLUSTER_Y; y++) {
+				for (int x = 0; x < CLUSTER_X; x++) {
+					glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+					for (int c = 0; c < 4; c++) {
+						float ndcX = -1.0f + 2.0f * (x + (c & 1)) / CLUSTER_X;
+						float ndcY = -1.0f + 2.0f * (y + (c >> 1)) / CLUSTER_Y;
+						glm::vec4 corner = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+						glm::vec3 onNear = glm::vec3(corner) / corner.w;
+						for (float depth : { sliceNear, sliceFar }) {
+							glm::vec3 point = onNear * (depth / nearPlane);
+							boxMin = glm::min(boxMin, point);
+							boxMax = glm::max(boxMax, point);
+						}
+					}
+					clusterBoxes[(z * CLUSTER_Y + y) * CLUSTER_X + x] = { boxMin, boxMax };
+				}
+			}
+		}
+	}
+
+	void LightClusters::update(const std::vector<PointLight>& lights, const glm::mat4& view, ThreadPool& pool)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		size_t lightCount = lights.size();
+		gpuLights.resize(lightCount);
+		bounds.resize(lightCount);
+		sliceIndices.resize(CLUSTER_Z);
+		sliceCounts.assign(CLUSTER_COUNT, 0);
+		const int SLICE_TILES = CLUSTER_X * CLUSTER_Y;
+
+		// 1) Datos de GPU y rango de clusters que puede tocar cada luz: rebanadas
+		// por su extensión en z y mosaicos por la proyección de su caja
+		pool.parallelFor(lightCount, 256, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const PointLight& light = lights[i];
+				GpuLight& gpu = gpuLights[i];
+				gpu.positionRadius = glm::vec4(light.position, light.radius);
+				gpu.colorType = glm::vec4(light.color, light.spot ? 1.0f : 0.0f);
+				gpu.spotDirection = glm::vec4(light.direction, light.cosCone);
+
+				LightBounds& box = bounds[i];
+				box.center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+				box.radius = light.radius;
+				float depthMin = std::max(-box.center.z - light.radius, nearDepth);
+				float depthMax = std::min(-box.center.z + light.radius, farDepth);
+				box.visible = depthMin <= depthMax;
+				if (!box.visible)
+					continue;
+				box.sliceBegin = std::max(0, std::min(CLUSTER_Z - 1, (int)std::floor(std::log(depthMin) * sliceScale + sliceBias)));
+				box.sliceEnd = std::max(0, std::min(CLUSTER_Z - 1, (int)std::floor(std::log(depthMax) * sliceScale + sliceBias)));
+
+				// Las esquinas detrás del plano cercano se llevan a él: la
+				// proyección de la caja recortada sigue siendo conservadora
+				glm::vec2 ndcMin(1e30f), ndcMax(-1e30f);
+				for (int c = 0; c < 8; c++) {
+					glm::vec3 corner = box.center + glm::vec3((c & 1) ? light.radius : -light.radius,
+						(c & 2) ? light.radius : -light.radius, (c & 4) ? light.radius : -light.radius);
+					corner.z = std::min(corner.z, -nearDepth);
+					glm::vec4 clip = clusterProjection * glm::vec4(corner, 1.0f);
+					glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+					ndcMin = glm::min(ndcMin, ndc);
+					ndcMax = glm::max(ndcMax, ndc);
+				}
+				box.visible = ndcMax.x >= -1.0f && ndcMin.x <= 1.0f && ndcMax.y >= -1.0f && ndcMin.y <= 1.0f;
+				box.tileMinX = std::max(0, (int)std::floor((ndcMin.x * 0.5f + 0.5f) * CLUSTER_X));
+				box.tileMaxX = std::min(CLUSTER_X - 1, (int)std::floor((ndcMax.x * 0.5f + 0.5f) * CLUSTER_X));
+				box.tileMinY = std::max(0, (int)std::floor((ndcMin.y * 0.5f + 0.5f) * CLUSTER_Y));
+				box.tileMaxY = std::min(CLUSTER_Y - 1, (int)std::floor((ndcMax.y * 0.5f + 0.5f) * CLUSTER_Y));
+			}
+		});
+
+		// 2) Cada rebanada prueba la esfera contra la caja de sus clusters y
+		// guarda pares (mosaico, luz) en su propia lista
+		pool.parallelFor(CLUSTER_Z, 1, [&](size_t begin, size_t end) {
+			for (size_t z = begin; z < end; z++) {
+				std::vector<uint32_t>& entries = sliceIndices[z];
+				entries.clear();
+				uint32_t* counts = &sliceCounts[z * SLICE_TILES];
+				for (size_t i = 0; i < lightCount; i++) {
+					const LightBounds& box = bounds[i];
+					if (!box.visible || (int)z < box.sliceBegin || (int)z > box.sliceEnd)
+						continue;
+					for (int y = box.tileMinY; y <= box.tileMaxY; y++) {
+						for (int x = box.tileMinX; x <= box.tileMaxX; x++) {
+							int tile = y * CLUSTER_X + x;
+							const Aabb& cluster = clusterBoxes[z * SLICE_TILES + tile];
+							glm::vec3 closest = glm::clamp(box.center, cluster.min, cluster.max);
+							glm::vec3 delta = closest - box.center;
+							if (glm::dot(delta, delta) > box.radius * box.radius)
+								continue;
+							entries.push_back(((uint32_t)tile << 20) | (uint32_t)i);
+							counts[tile]++;
+						}
+					}
+				}
+			}
+		});
+
+		// 3) Offsets por cluster; con texture buffers la lista se recorta al
+		// tamaño máximo que admite la implementación
+		size_t limit = useStorage ? (size_t)-1 : (size_t)std::max(maxTexels, 1);
+		ranges.resize(CLUSTER_COUNT);
+		frameStats = LightClusterStats();
+		frameStats.lights = (int)lightCount;
+		size_t offset = 0;
+		for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+			size_t count = sliceCounts[cluster];
+			size_t kept = offset < limit ? std::min(count, limit - offset) : 0;
+			ranges[cluster] = glm::uvec2((uint32_t)offset, (uint32_t)kept);
+			frameStats.droppedIndices += (int)(count - kept);
+			frameStats.maxPerCluster = std::max(frameStats.maxPerCluster, (int)count);
+			frameStats.occupiedClusters += count > 0 ? 1 : 0;
+			offset += kept;
+		}
+		indices.resize(offset);
+		frameStats.indices = (int)offset;
+
+		// 4) Cada rebanada reparte sus pares en el rango de su cluster
+		pool.parallelFor(CLUSTER_Z, 1, [&](size_t begin, size_t end) {
+			std::vector<uint32_t> cursor(SLICE_TILES);
+			for (size_t z = begin; z < end; z++) {
+				std::fill(cursor.begin(), cursor.end(), 0);
+				for (uint32_t entry : sliceIndices[z]) {
+					int tile = (int)(entry >> 20);
+					const glm::uvec2& range = ranges[z * SLICE_TILES + tile];
+					if (cursor[tile] < range.y)
+						indices[range.x + cursor[tile]++] = entry & 0xFFFFF;
+				}
+			}
+		});
+		frameStats.assignMs = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+
+		upload(buffers[0], gpuLights.data(), gpuLights.size() * sizeof(GpuLight));
+		upload(buffers[1], ranges.data(), ranges.size() * sizeof(glm::uvec2));
+		upload(buffers[2], indices.data(), indices.size() * sizeof(uint32_t));
+	}
+
+	void LightClusters::upload(GLuint buffer, const void* data, size_t bytes)
+	{
+		// Se huérfana el almacenamiento cada frame para no esperar a la GPU;
+		// la textura de buffer sigue asociada al mismo objeto
+		GLenum target = useStorage ? GL_SHADER_STORAGE_BUFFER : GL_TEXTURE_BUFFER;
+		glBindBuffer(target, buffer);
+		glBufferData(target, std::max(bytes, (size_t)16), NULL, GL_STREAM_DRAW);
+		if (bytes)
+			glBufferSubData(target, 0, bytes, data);
+		glBindBuffer(target, 0);
+	}
+
+	void LightClusters::bind(GLuint firstTextureUnit) const
+	{
+		if (useStorage) {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHTS_BINDING, buffers[0]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RANGES_BINDING, buffers[1]);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDICES_BINDING, buffers[2]);
+			return;
+		}
+		for (int i = 0; i < 3; i++) {
+			glActiveTexture(GL_TEXTURE0 + firstTextureUnit + i);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		}
+	}
+
+}
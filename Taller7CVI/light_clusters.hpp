@@ -0,0 +1,114 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "culling.hpp"
+
+namespace myopengl {
+
+	class ThreadPool;
+
+	// Grilla de clusters: mosaicos en pantalla por rebanadas exponenciales
+	// de profundidad (cada rebanada es más gruesa cuanto más lejos)
+	const int CLUSTER_X = 16;
+	const int CLUSTER_Y = 9;
+	const int CLUSTER_Z = 24;
+	const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+	// Luz puntual o focal (cono) con alcance finito
+	struct PointLight {
+		glm::vec3 position;
+		float radius;
+		glm::vec3 color;
+		bool spot;
+		glm::vec3 direction; // solo focales: hacia dónde apunta
+		float cosCone;       // solo focales: coseno del semiángulo del cono
+	};
+
+	// Elemento del arreglo de luces en la GPU (std430 / 3 texels RGBA32F)
+	struct GpuLight {
+		glm::vec4 positionRadius;
+		glm::vec4 colorType;      // rgb, w = 1 si es focal
+		glm::vec4 spotDirection;  // xyz, w = coseno del cono
+	};
+
+	struct LightClusterStats {
+		int lights = 0;
+		int indices = 0;           // entradas de la lista de índices
+		int maxPerCluster = 0;
+		int occupiedClusters = 0;
+		int droppedIndices = 0;    // recortadas por el límite de texture buffers
+		double assignMs = 0.0;
+	};
+
+	// Clustered forward shading: la CPU reparte las luces entre los clusters
+	// del frustum de la cámara y sube tres listas que lee el fragment shader:
+	// las luces, un rango (offset, cantidad) por cluster y los índices de
+	// luz de cada cluster. Con GL 4.3 se usan shader storage buffers
+	// (bindings LIGHTS_BINDING...); si no, texture buffers en las unidades
+	// indicadas a bind().
+	class LightClusters {
+	public:
+		static const GLuint LIGHTS_BINDING = 2;
+		static const GLuint RANGES_BINDING = 3;
+		static const GLuint INDICES_BINDING = 4;
+
+		LightClusters() = default;
+		~LightClusters();
+		LightClusters(const LightClusters&) = delete;
+		LightClusters& operator=(const LightClusters&) = delete;
+
+		void create(bool storageBuffers);
+		void destroy();
+
+		// Recalcula las cajas de los clusters (solo si cambió la proyección)
+		void setProjection(const glm::mat4& projection, float nearPlane, float farPlane);
+
+		// Reparte las luces entre los clusters y sube las listas a la GPU
+		void update(const std::vector<PointLight>& lights, const glm::mat4& view, ThreadPool& pool);
+
+		// Vincula los buffers (SSBO) o las texturas de buffer (unidades
+		// firstTextureUnit, +1 y +2) según el camino elegido en create()
+		void bind(GLuint firstTextureUnit) const;
+
+		// Escala y sesgo para obtener la rebanada desde la profundidad de vista:
+		// slice = log(depth) * depthScale + depthBias
+		float depthScale() const { return sliceScale; }
+		float depthBias() const { return sliceBias; }
+		bool storageBuffers() const { return useStorage; }
+		const LightClusterStats& stats() const { return frameStats; }
+
+	private:
+		struct LightBounds {
+			glm::vec3 center; // espacio de vista
+			float radius;
+			int sliceBegin, sliceEnd;
+			int tileMinX, tileMaxX, tileMinY, tileMaxY;
+			bool visible;
+		};
+
+		void upload(GLuint buffer, const void* data, size_t bytes);
+
+		Aabb clusterBoxes[CLUSTER_COUNT];
+		glm::mat4 clusterProjection = glm::mat4(0.0f);
+		float nearDepth = 0.1f;
+		float farDepth = 100.0f;
+		float sliceScale = 0.0f;
+		float sliceBias = 0.0f;
+
+		std::vector<GpuLight> gpuLights;
+		std::vector<LightBounds> bounds;
+		std::vector<std::vector<uint32_t>> sliceIndices; // índices por rebanada
+		std::vector<uint32_t> sliceCounts;               // luces por cluster, en orden de cluster
+		std::vector<glm::uvec2> ranges;
+		std::vector<uint32_t> indices;
+
+		bool useStorage = false;
+		GLint maxTexels = 0;
+		GLuint buffers[3] = {};
+		GLuint textures[3] = {};
+		LightClusterStats frameStats;
+	};
+
+}
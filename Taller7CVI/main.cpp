@@ -9,8 +9,38 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include "myopengl.hpp"
+#include "shader_program.hpp"
+#include "uniform_buffer.hpp"
+#include "stream_buffer.hpp"
+#include "mesh.hpp"
+#include "normal_matrix.hpp"
+#include "benchmark.hpp"
+#include "scene_graph.hpp"
+#include "culling.hpp"
+#include "bvh.hpp"
+#include "shadow_cascades.hpp"
+#include "shadow_moments.hpp"
+#include "shadow_cache.hpp"
+#include "thread_pool.hpp"
+#include "light_clusters.hpp"
+#include "gbuffer.hpp"
+#include "hiz_culling.hpp"
+#include "texture_loader.hpp"
+#include "texture_cache.hpp"
+#include "texture_cooker.hpp"
+#include "asset_pack.hpp"
+#include "texture_array.hpp"
 #include <vector>
 #include <string>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstdlib>
+#include <initializer_list>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -33,117 +63,490 @@ const char* vertexShaderSource = R"(
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+// Datos por instancia (solo se leen con useInstancing)
+layout (location = 3) in mat4 aInstanceModel; // ocupa las ubicaciones 3-6
+layout (location = 7) in int aMaterialIndex;
+layout (location = 8) in mat3 aInstanceNormalMatrix; // ubicaciones 8-10
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
-out vec4 FragPosLightSpace;
+out float ViewDepth;
+flat out int MaterialIndex;
+
+// Datos por frame compartidos con el programa de profundidad (binding 0)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[4]; // una por cascada (MAX_CASCADES)
+    vec4 cascadeSplits;         // profundidad de vista donde termina cada cascada
+    vec4 cascadeBiasScale;      // corrige el bias según el rango z de cada cascada
+    vec4 viewPos;
+    vec4 lightDir;
+    ivec4 cascadeInfo;          // x = número de cascadas
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+uniform mat3 normalMatrix;
+uniform int materialIndex;
+uniform bool useInstancing;
+// Si está activo, la matriz normal llega calculada desde la CPU (una por objeto)
+uniform bool cpuNormalMatrix;
+// Misma profundidad que la pre-pasada, bit a bit (necesario para GL_EQUAL)
+invariant gl_Position;
 
 void main() {
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    mat4 objectModel = useInstancing ? aInstanceModel : model;
+    MaterialIndex = useInstancing ? aMaterialIndex : materialIndex;
+    vec4 worldPos = objectModel * vec4(aPos, 1.0);
     FragPos = worldPos.xyz;
     // Transformamos la normal (asegurando la corrección en escalados no uniformes)
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    if (cpuNormalMatrix)
+        Normal = (useInstancing ? aInstanceNormalMatrix : normalMatrix) * aNormal;
+    else
+        Normal = mat3(transpose(inverse(objectModel))) * aNormal;
     TexCoord = aTexCoord;
-    FragPosLightSpace = lightSpaceMatrix * worldPos;
-    gl_Position = projection * view * worldPos;
+    vec4 viewPosition = view * worldPos;
+    ViewDepth = -viewPosition.z;
+    gl_Position = projection * viewPosition;
 }
 )";
 
-const char* fragmentShaderSource = R"(
-#version 330 core
-out vec4 FragColor;
+// --- Fragmentos de shader compartidos por el renderizado forward y el diferido ---
+// No llevan #version: main() antepone la versión (430 si hay SSBO) y el
+// tamaño de la grilla de clusters (CLUSTER_X/Y/Z) y los concatena.
 
-in vec3 FragPos;
-in vec3 Normal;
-in vec2 TexCoord;
-in vec4 FragPosLightSpace;
-
-uniform sampler2D diffuseTexture; // Usado si no se activa multitextura
-uniform sampler2D texture1;
-uniform sampler2D texture2;
-uniform sampler2D texture3;
-uniform bool useMultiTexture;
-uniform bool useTexture;
-uniform float mixRatio1;
-uniform float mixRatio2;
-uniform float mixRatio3;
-
-uniform sampler2D shadowMap;
-uniform vec3 lightDir; // Dirección de la luz (normalizada)
-uniform vec3 viewPos;
-
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
+// Materiales: color base a partir de las texturas del material
+const char* materialShaderSource = R"(
+// Materiales indexados por objeto (binding 1, ver MaterialUniforms)
+struct Material {
+    ivec4 textures;  // texIndex1, texIndex2, texIndex3, flags
+    vec4 mixRatios;  // mixRatio1, mixRatio2, mixRatio3
+};
+layout (std140) uniform Materials {
+    Material materials[256];
+};
+
+// Todas las texturas son capas de un mismo arreglo (unidad 0) y cada
+// material elige las suyas por índice de capa.
+uniform sampler2DArray materialLayers;
+
+vec4 sampleMaterial(int layer, vec2 uv)
+{
+    return texture(materialLayers, vec3(uv, float(layer)));
+}
+
+vec3 materialBaseColor(Material material, vec2 uv)
 {
+    // flags: bit 0 = useTexture, bit 1 = useMultiTexture
+    int flags = material.textures.w;
+    if((flags & 1) == 0)
+        return vec3(1.0);
+    if((flags & 2) == 0)
+        return sampleMaterial(material.textures.x, uv).rgb;
+    vec3 ratios = material.mixRatios.xyz;
+    vec4 tex1 = sampleMaterial(material.textures.x, uv) * ratios.x;
+    vec4 tex2 = sampleMaterial(material.textures.y, uv) * ratios.y;
+    vec4 tex3 = sampleMaterial(material.textures.z, uv) * ratios.z;
+    float totalRatio = ratios.x + ratios.y + ratios.z;
+    if(totalRatio > 0.0) {
+        tex1 *= (ratios.x / totalRatio);
+        tex2 *= (ratios.y / totalRatio);
+        tex3 *= (ratios.z / totalRatio);
+    }
+    return (tex1 + tex2 + tex3).rgb;
+}
+)";
+
+// Iluminación: luz direccional con sombras en cascada y luces en clusters
+const char* lightingShaderSource = R"(
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[4]; // una por cascada (MAX_CASCADES)
+    vec4 cascadeSplits;         // profundidad de vista donde termina cada cascada
+    vec4 cascadeBiasScale;      // corrige el bias según el rango z de cada cascada
+    vec4 viewPos;
+    vec4 lightDir; // Dirección de la luz (normalizada)
+    ivec4 cascadeInfo;
+};
+
+// Una capa por cascada: la misma textura con dos samplers, profundidad
+// cruda (unidad 5) y comparación por hardware con filtrado lineal (unidad 6)
+uniform sampler2DArray shadowMap;
+uniform sampler2DArrayShadow shadowMapCompare;
+uniform bool showCascades;
+// Filtrado (ver ShadowFilter): 0 = una muestra, 1 = hardware 2x2,
+// 2 = PCF de (2 * pcfRadius + 1)^2 muestras, 3 = disco de Poisson,
+// 4 = VSM y 5 = EVSM (momentos prefiltrados, unidad 7)
+uniform int shadowFilter;
+uniform int pcfRadius;
+uniform float poissonRadius; // en texels
+uniform sampler2DArray shadowMoments;
+uniform float positiveExponent;
+uniform float negativeExponent;
+uniform float lightBleedReduction;
+
+const vec2 poissonDisk[16] = vec2[16](
+    vec2(-0.94201624, -0.39906216), vec2(0.94558609, -0.76890725),
+    vec2(-0.09418410, -0.92938870), vec2(0.34495938, 0.29387760),
+    vec2(-0.91588581, 0.45771432), vec2(-0.81544232, -0.87912464),
+    vec2(-0.38277543, 0.27676845), vec2(0.97484398, 0.75648379),
+    vec2(0.44323325, -0.97511554), vec2(0.53742981, -0.47373420),
+    vec2(-0.26496911, -0.41893023), vec2(0.79197514, 0.19090188),
+    vec2(-0.24188840, 0.99706507), vec2(-0.81409955, 0.91437590),
+    vec2(0.19984126, 0.78641367), vec2(0.14383161, -0.14100790)
+);
+
+// Luces puntuales y focales repartidas en clusters (ver LightClusters)
+struct PointLight {
+    vec4 positionRadius;
+    vec4 colorType;     // rgb, w = 1 si es focal
+    vec4 spotDirection; // xyz, w = coseno del cono
+};
+#ifdef LIGHT_LIST_SSBO
+layout (std430, binding = 2) readonly buffer Lights { PointLight lights[]; };
+layout (std430, binding = 3) readonly buffer ClusterRanges { uvec2 clusterRanges[]; };
+layout (std430, binding = 4) readonly buffer LightIndices { uint lightIndices[]; };
+PointLight fetchLight(uint index) { return lights[index]; }
+uvec2 fetchClusterRange(int cluster) { return clusterRanges[cluster]; }
+uint fetchLightIndex(uint i) { return lightIndices[i]; }
+#else
+// Sin SSBO las mismas listas llegan como texture buffers (unidades 8-10)
+uniform samplerBuffer lightBuffer;
+uniform usamplerBuffer clusterRangeBuffer;
+uniform usamplerBuffer lightIndexBuffer;
+PointLight fetchLight(uint index)
+{
+    int texel = int(index) * 3;
+    return PointLight(texelFetch(lightBuffer, texel), texelFetch(lightBuffer, texel + 1), texelFetch(lightBuffer, texel + 2));
+}
+uvec2 fetchClusterRange(int cluster) { return texelFetch(clusterRangeBuffer, cluster).xy; }
+uint fetchLightIndex(uint i) { return texelFetch(lightIndexBuffer, int(i)).x; }
+#endif
+uniform int pointLightCount;
+// xy: clusters por píxel; z, w: rebanada = log(profundidad) * z + w
+uniform vec4 clusterScale;
+
+// Primera cascada que contiene el fragmento, o -1 si está más lejos que todas
+int selectCascade(float viewDepth)
+{
+    for(int i = 0; i < cascadeInfo.x; i++) {
+        if(viewDepth < cascadeSplits[i])
+            return i;
+    }
+    return -1;
+}
+
+// Cota de Chebyshev: probabilidad de que el receptor esté iluminado dados
+// la media y la varianza de la profundidad de los oclusores. Las colas por
+// debajo de lightBleedReduction se recortan para reducir el "light bleeding".
+float chebyshevUpperBound(vec2 moments, float depth, float minVariance)
+{
+    if(depth <= moments.x)
+        return 1.0;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float distance = depth - moments.x;
+    float pMax = variance / (variance + distance * distance);
+    return clamp((pMax - lightBleedReduction) / (1.0 - lightBleedReduction), 0.0, 1.0);
+}
+
+// positionDx/positionDy: derivadas de la posición calculadas fuera de toda
+// rama (o desde la profundidad en diferido), para elegir el mip de los
+// momentos aunque la cascada varíe por píxel
+float ShadowCalculation(int cascade, vec3 position, vec3 normal, vec3 lightDir, vec3 positionDx, vec3 positionDy)
+{
+    if(cascade < 0)
+        return 0.0;
+    vec4 fragPosLightSpace = lightSpaceMatrices[cascade] * vec4(position, 1.0);
     // Dividir por w y transformar de [-1,1] a [0,1]
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
-    // Obtener la profundidad más cercana del mapa de sombras
-    float closestDepth = texture(shadowMap, projCoords.xy).r;
-    float currentDepth = projCoords.z;
-    // Bias para reducir artefactos (shadow acne)
-    float bias = max(0.05 * (1.0 - dot(normal, -lightDir)), 0.005);
-    // Determinar si está en sombra
-    float shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
     // Si el fragmento está fuera del rango, no aplicar sombra
     if(projCoords.z > 1.0)
-        shadow = 0.0;
-    return shadow;
-}
+        return 0.0;
+    float currentDepth = projCoords.z;
 
-void main() {
-    vec3 baseColor;
-    if(useTexture) {
-        if(useMultiTexture) {
-            vec4 tex1 = texture(texture1, TexCoord) * mixRatio1;
-            vec4 tex2 = texture(texture2, TexCoord) * mixRatio2;
-            vec4 tex3 = texture(texture3, TexCoord) * mixRatio3;
-            float totalRatio = mixRatio1 + mixRatio2 + mixRatio3;
-            if(totalRatio > 0.0) {
-                tex1 *= (mixRatio1 / totalRatio);
-                tex2 *= (mixRatio2 / totalRatio);
-                tex3 *= (mixRatio3 / totalRatio);
+    if(shadowFilter >= 4) {
+        // La proyección de la luz es afín: las derivadas se transforman con ella
+        mat3 lightLinear = mat3(lightSpaceMatrices[cascade]);
+        vec2 uvDx = (lightLinear * positionDx).xy * 0.5;
+        vec2 uvDy = (lightLinear * positionDy).xy * 0.5;
+        vec4 moments = textureGrad(shadowMoments, vec3(projCoords.xy, cascade), uvDx, uvDy);
+        if(shadowFilter == 4)
+            return 1.0 - chebyshevUpperBound(moments.xy, currentDepth, 0.00002);
+        // EVSM: la misma deformación que al generar los momentos
+        float warped = 2.0 * currentDepth - 1.0;
+        float positive = exp(positiveExponent * warped);
+        float negative = -exp(-negativeExponent * warped);
+        float positiveScale = 0.0001 * positiveExponent * positive;
+        float negativeScale = 0.0001 * negativeExponent * negative;
+        float positiveLit = chebyshevUpperBound(moments.xy, positive, positiveScale * positiveScale);
+        float negativeLit = chebyshevUpperBound(moments.zw, negative, negativeScale * negativeScale);
+        return 1.0 - min(positiveLit, negativeLit);
+    }
+    // Bias para reducir artefactos (shadow acne)
+    float bias = max(0.05 * (1.0 - dot(normal, -lightDir)), 0.005) * cascadeBiasScale[cascade];
+    float reference = currentDepth - bias;
+
+    if(shadowFilter == 0) {
+        // Profundidad más cercana del mapa y comparación manual
+        float closestDepth = texture(shadowMap, vec3(projCoords.xy, cascade)).r;
+        return reference > closestDepth ? 1.0 : 0.0;
+    }
+    // La comparación por hardware devuelve la fracción iluminada
+    if(shadowFilter == 1)
+        return 1.0 - texture(shadowMapCompare, vec4(projCoords.xy, cascade, reference));
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    if(shadowFilter == 2) {
+        for(int x = -pcfRadius; x <= pcfRadius; x++) {
+            for(int y = -pcfRadius; y <= pcfRadius; y++) {
+                vec2 offset = vec2(x, y) * texelSize;
+                lit += texture(shadowMapCompare, vec4(projCoords.xy + offset, cascade, reference));
             }
-            baseColor = (tex1 + tex2 + tex3).rgb;
-        } else {
-            baseColor = texture(diffuseTexture, TexCoord).rgb;
         }
-    } else {
-        baseColor = vec3(1.0);
+        float side = float(2 * pcfRadius + 1);
+        return 1.0 - lit / (side * side);
     }
-    
-    vec3 norm = normalize(Normal);
+    // Disco rotado con un ángulo por píxel (ruido de gradiente intercalado):
+    // cambia el bandeado de pocas muestras por ruido de alta frecuencia
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    for(int i = 0; i < 16; i++) {
+        vec2 offset = rotation * poissonDisk[i] * poissonRadius * texelSize;
+        lit += texture(shadowMapCompare, vec4(projCoords.xy + offset, cascade, reference));
+    }
+    return 1.0 - lit / 16.0;
+}
+
+// Suma de las luces del cluster del fragmento (solo las que lo alcanzan)
+vec3 clusteredLighting(vec3 baseColor, vec3 position, float viewDepth, vec3 normal, vec3 viewDir)
+{
+    if(pointLightCount == 0)
+        return vec3(0.0);
+    ivec3 cell = ivec3(vec3(gl_FragCoord.xy * clusterScale.xy, log(viewDepth) * clusterScale.z + clusterScale.w));
+    cell = clamp(cell, ivec3(0), ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, CLUSTER_Z - 1));
+    uvec2 range = fetchClusterRange((cell.z * CLUSTER_Y + cell.y) * CLUSTER_X + cell.x);
+    vec3 result = vec3(0.0);
+    for(uint i = 0u; i < range.y; i++) {
+        PointLight light = fetchLight(fetchLightIndex(range.x + i));
+        vec3 toLight = light.positionRadius.xyz - position;
+        float distance = length(toLight);
+        float radius = light.positionRadius.w;
+        if(distance >= radius)
+            continue;
+        vec3 L = toLight / distance;
+        // Atenuación inversa al cuadrado con una ventana que llega a 0 en el radio
+        float ratio = distance / radius;
+        float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        if(light.colorType.w > 0.5) {
+            float cosCone = light.spotDirection.w;
+            attenuation *= smoothstep(cosCone, mix(cosCone, 1.0, 0.25), dot(-L, light.spotDirection.xyz));
+        }
+        float diff = max(dot(normal, L), 0.0);
+        float spec = pow(max(dot(normal, normalize(L + viewDir)), 0.0), 32.0);
+        result += light.colorType.rgb * attenuation * (diff * baseColor + vec3(0.3) * spec);
+    }
+    return result;
+}
+
+// Color final de una superficie: luz direccional con sombra, luces en
+// clusters y, opcionalmente, el tinte de la cascada
+vec3 shadeSurface(vec3 baseColor, vec3 norm, vec3 position, float viewDepth, vec3 positionDx, vec3 positionDy)
+{
+    vec3 lightDirection = lightDir.xyz;
     // Cálculos de iluminación
     vec3 ambient = 0.15 * baseColor;
-    float diff = max(dot(norm, -lightDir), 0.0);
+    float diff = max(dot(norm, -lightDirection), 0.0);
     vec3 diffuse = diff * baseColor;
-    vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 reflectDir = reflect(lightDir, norm);
+    vec3 viewDir = normalize(viewPos.xyz - position);
+    vec3 reflectDir = reflect(lightDirection, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
     vec3 specular = vec3(0.3) * spec;
     
     // Cálculo de sombra
-    float shadow = ShadowCalculation(FragPosLightSpace, norm, lightDir);
+    int cascade = selectCascade(viewDepth);
+    float shadow = ShadowCalculation(cascade, position, norm, lightDirection, positionDx, positionDy);
     vec3 lighting = ambient + (1.0 - shadow) * (diffuse + specular);
-    
-    FragColor = vec4(lighting, 1.0);
+    lighting += clusteredLighting(baseColor, position, viewDepth, norm, viewDir);
+    if(showCascades && cascade >= 0) {
+        const vec3 cascadeColors[4] = vec3[4](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+        lighting *= cascadeColors[cascade];
+    }
+    return lighting;
+}
+)";
+
+
+// Pasada forward: ilumina cada fragmento al rasterizarlo
+const char* fragmentShaderSource = R"(
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+in float ViewDepth;
+flat in int MaterialIndex;
+
+void main() {
+    vec3 baseColor = materialBaseColor(materials[MaterialIndex], TexCoord);
+    vec3 positionDx = dFdx(FragPos);
+    vec3 positionDy = dFdy(FragPos);
+    FragColor = vec4(shadeSurface(baseColor, normalize(Normal), FragPos, ViewDepth, positionDx, positionDy), 1.0);
 }
 )";
 
+// Pasada diferida 1: color base y normal en el G-buffer (sin iluminar)
+const char* gbufferFragmentShaderSource = R"(
+layout (location = 0) out vec4 GAlbedo;
+layout (location = 1) out vec2 GNormal;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+in float ViewDepth;
+flat in int MaterialIndex;
+
+// Normal en dos componentes (proyección octaédrica)
+vec2 encodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 folded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : folded;
+}
+
+void main() {
+    GAlbedo = vec4(materialBaseColor(materials[MaterialIndex], TexCoord), 1.0);
+    GNormal = encodeNormal(normalize(Normal));
+}
+)";
+
+// Pasada diferida 2: un triángulo que cubre la pantalla
+const char* deferredVertexShaderSource = R"(
+#version 330 core
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+// Pasada diferida 2: reconstruye la posición desde la profundidad e ilumina
+// cada píxel una sola vez, sin importar cuántas superficies se solaparon
+const char* deferredFragmentShaderSource = R"(
+out vec4 FragColor;
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+vec3 decodeNormal(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+vec3 reconstructPosition(ivec2 texel, float depth)
+{
+    vec2 ndc = (vec2(texel) + 0.5) / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec4 world = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);
+    return world.xyz / world.w;
+}
+
+// Derivada de la posición hacia direction, tomada del vecino con geometría y la
+// profundidad más parecida: dFdx/dFdy mezclarían el fondo en las siluetas
+vec3 positionDelta(ivec2 texel, ivec2 direction, float depth, vec3 position)
+{
+    ivec2 size = textureSize(gDepth, 0);
+    vec3 delta = vec3(0.0);
+    float best = 1.0;
+    for(int side = -1; side <= 1; side += 2) {
+        ivec2 neighbour = texel + direction * side;
+        if(any(lessThan(neighbour, ivec2(0))) || any(greaterThanEqual(neighbour, size)))
+            continue;
+        float neighbourDepth = texelFetch(gDepth, neighbour, 0).r;
+        float difference = abs(neighbourDepth - depth);
+        if(neighbourDepth == 1.0 || difference >= best)
+            continue;
+        best = difference;
+        delta = (reconstructPosition(neighbour, neighbourDepth) - position) * float(side);
+    }
+    return delta;
+}
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, texel, 0).r;
+    // Sin geometría: queda el color de fondo
+    if(depth == 1.0)
+        discard;
+    vec3 position = reconstructPosition(texel, depth);
+    vec3 positionDx = positionDelta(texel, ivec2(1, 0), depth, position);
+    vec3 positionDy = positionDelta(texel, ivec2(0, 1), depth, position);
+    float viewDepth = -(view * vec4(position, 1.0)).z;
+    vec3 baseColor = texelFetch(gAlbedo, texel, 0).rgb;
+    vec3 normal = decodeNormal(texelFetch(gNormal, texel, 0).xy);
+    FragColor = vec4(shadeSurface(baseColor, normal, position, viewDepth, positionDx, positionDy), 1.0);
+}
+)";
 // Shader para la pasada de profundidad (solo guarda la profundidad)
 const char* depthVertexShaderSource = R"(
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[4]; // una por cascada (MAX_CASCADES)
+    vec4 cascadeSplits;         // profundidad de vista donde termina cada cascada
+    vec4 cascadeBiasScale;      // corrige el bias según el rango z de cada cascada
+    vec4 viewPos;
+    vec4 lightDir;
+    ivec4 cascadeInfo;          // x = número de cascadas
+};
 uniform mat4 model;
-uniform mat4 lightSpaceMatrix;
+uniform bool useInstancing;
+void main()
+{
+    // Posición de mundo: el geometry shader la proyecta en cada cascada
+    mat4 objectModel = useInstancing ? aInstanceModel : model;
+    gl_Position = objectModel * vec4(aPos, 1.0);
+}
+)";
+// Renderizado por capas: cada triángulo se emite una vez por cascada en
+// su capa del arreglo de mapas de sombra (una sola pasada para todas)
+const char* depthGeometryShaderSource = R"(
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 12) out;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[4];
+    vec4 cascadeSplits;
+    vec4 cascadeBiasScale;
+    vec4 viewPos;
+    vec4 lightDir;
+    ivec4 cascadeInfo;
+};
+// Cascadas a dibujar este frame (bit c = capa c); el resto sigue en caché
+uniform int cascadeMask;
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    for(int cascade = 0; cascade < cascadeInfo.x; cascade++) {
+        if((cascadeMask & (1 << cascade)) == 0)
+            continue;
+        gl_Layer = cascade;
+        for(int v = 0; v < 3; v++) {
+            gl_Position = lightSpaceMatrices[cascade] * gl_in[v].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
 }
 )";
 
@@ -155,8 +558,37 @@ void main()
 }
 )";
 
+// Pre-pasada de profundidad desde la cámara: solo posición, con el mismo
+// cálculo que vertexShaderSource para que la profundidad coincida
+const char* prepassVertexShaderSource = R"(
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceModel;
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 lightSpaceMatrices[4];
+    vec4 cascadeSplits;
+    vec4 cascadeBiasScale;
+    vec4 viewPos;
+    vec4 lightDir;
+    ivec4 cascadeInfo;
+};
+uniform mat4 model;
+uniform bool useInstancing;
+invariant gl_Position;
+void main()
+{
+    mat4 objectModel = useInstancing ? aInstanceModel : model;
+    vec4 worldPos = objectModel * vec4(aPos, 1.0);
+    vec4 viewPosition = view * worldPos;
+    gl_Position = projection * viewPosition;
+}
+)";
+
 // --- GEOMETRÍA ---
-// Definición de un cubo con 36 vértices (cada vértice: posición, normal, coord. de textura)
+// Definición de un cubo con 36 vértices (cada vértice: posición, normal, coord. de textura).
+// buildIndexedMesh los suelda en 24 vértices únicos más un índice de 16 bits.
 float cubeVertices[] = {
     // Posición             // Normal           // TexCoord
     // Front face
@@ -215,38 +647,10 @@ float planeVertices[] = {
      10.0f, -2.5f, -10.0f,      0.0f, 1.0f, 0.0f,   10.0f, 10.0f
 };
 
-// Función para cargar texturas desde archivo
-unsigned int loadTexture(const char* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // Invertir verticalmente
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        // Parámetros de la textura
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        stbi_image_free(data);
-    }
-    else {
-        std::cout << "Error al cargar textura: " << path << std::endl;
-        stbi_image_free(data);
-    }
-    return textureID;
-}
+// Texturas de la escena (también las que cocina --cook)
+const char* textureFiles[] = { "textures/wood.jpg", "textures/metal.jpg", "textures/concrete.jpg",
+    "textures/grass.jpeg", "textures/stone.jpeg" };
+const char* textureFileNames[] = { "Wood", "Metal", "Concrete", "Grass", "Stone" };
 
 // Estructura para la configuración de multitextura
 struct MultiTextureConfig {
@@ -259,7 +663,488 @@ struct MultiTextureConfig {
     float mixRatio3;
 };
 
-int main() {
+// Datos por instancia para el modo instanciado (deben coincidir con las
+// ubicaciones 3-10 del vertex shader)
+struct InstanceData {
+    glm::mat4 model;
+    int materialIndex;
+    int padding[3];
+    glm::vec4 normalMatrix[3]; // inversa transpuesta de model (columnas, w sin uso)
+};
+
+// Bloque FrameData (std140, binding 0): compartido por todos los programas
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 lightSpaceMatrices[MAX_CASCADES];
+    glm::vec4 cascadeSplits;
+    glm::vec4 cascadeBiasScale;
+    glm::vec4 viewPos;
+    glm::vec4 lightDir;
+    glm::ivec4 cascadeInfo; // x = número de cascadas
+};
+
+// Elemento del bloque Materials (std140, binding 1)
+struct MaterialUniforms {
+    glm::ivec4 textures;   // texIndex1, texIndex2, texIndex3, flags
+    glm::vec4 mixRatios;   // mixRatio1, mixRatio2, mixRatio3, sin uso
+};
+
+const int MAX_MATERIALS = 256; // Tamaño del arreglo materials[] en el shader
+const int MOBILE_PIECES = 12;
+const int FLOOR_MATERIAL = MOBILE_PIECES;
+const int MAX_MOBILES = 4096;
+const float MOBILE_SPACING = 8.0f;
+
+// Modos de culling por frustum
+enum CullingMode {
+    CULLING_OFF,
+    CULLING_FLAT, // todas las cajas contra el frustum (SIMD, en paralelo)
+    CULLING_BVH   // recorrido de la jerarquía de cajas
+};
+const float BVH_REBUILD_RATIO = 1.5f; // se reconstruye si el SAH reajustado crece más que esto
+
+// Mallas dentro de la geometría compartida (un VBO/IBO y un VAO)
+enum SceneMesh {
+    MESH_CUBE,
+    MESH_PLANE,
+    MESH_COUNT
+};
+// Nombres de las mallas dentro del paquete de recursos
+const char* meshAssetNames[MESH_COUNT] = { "meshes/cube", "meshes/plane" };
+const char* ASSET_PACK_PATH = "assets.pack";
+
+// Caminos de la pasada 2
+enum RenderPath {
+    RENDER_FORWARD,  // cada fragmento se ilumina al rasterizarse
+    RENDER_DEFERRED  // G-buffer y luego una pasada de iluminación en pantalla
+};
+
+// Uniforms por objeto de los programas que dibujan la geometría
+// (forward y G-buffer comparten el vertex shader)
+struct SurfaceUniforms {
+    Uniform<glm::mat4> model;
+    Uniform<int> materialIndex;
+    Uniform<bool> useInstancing;
+    Uniform<glm::mat3> normalMatrix;
+    Uniform<bool> cpuNormalMatrix;
+
+    explicit SurfaceUniforms(ShaderProgram& program)
+        : model(program.uniform<glm::mat4>("model")),
+          materialIndex(program.uniform<int>("materialIndex")),
+          useInstancing(program.uniform<bool>("useInstancing")),
+          normalMatrix(program.uniform<glm::mat3>("normalMatrix")),
+          cpuNormalMatrix(program.uniform<bool>("cpuNormalMatrix")) {}
+};
+
+// Uniforms de iluminación y sombras (lightingShaderSource), comunes al
+// programa forward y a la pasada de iluminación diferida
+struct LightingUniforms {
+    Uniform<bool> showCascades;
+    Uniform<int> shadowFilter;
+    Uniform<int> pcfRadius;
+    Uniform<float> poissonRadius;
+    Uniform<float> lightBleedReduction;
+    Uniform<int> pointLightCount;
+    Uniform<glm::vec4> clusterScale;
+
+    // Resuelve los uniforms y fija las unidades de textura (5 y 6 para el
+    // mapa de sombras, 7 para los momentos y 8-10 para las listas de luces
+    // sin SSBO). El programa queda activo.
+    explicit LightingUniforms(ShaderProgram& program)
+        : showCascades(program.uniform<bool>("showCascades")),
+          shadowFilter(program.uniform<int>("shadowFilter")),
+          pcfRadius(program.uniform<int>("pcfRadius")),
+          poissonRadius(program.uniform<float>("poissonRadius")),
+          lightBleedReduction(program.uniform<float>("lightBleedReduction")),
+          pointLightCount(program.uniform<int>("pointLightCount")),
+          clusterScale(program.uniform<glm::vec4>("clusterScale")) {
+        program.use();
+        program.uniform<int>("shadowMap").set(5);
+        program.uniform<int>("shadowMapCompare").set(6);
+        program.uniform<int>("shadowMoments").set(7);
+        program.uniform<int>("lightBuffer").set(8);
+        program.uniform<int>("clusterRangeBuffer").set(9);
+        program.uniform<int>("lightIndexBuffer").set(10);
+        program.uniform<float>("positiveExponent").set(EVSM_POSITIVE_EXPONENT);
+        program.uniform<float>("negativeExponent").set(EVSM_NEGATIVE_EXPONENT);
+    }
+};
+
+// Apunta los atributos 3-7 del VAO activo a las instancias que empiezan en
+// baseOffset dentro del GL_ARRAY_BUFFER activo
+void setInstanceAttributes(GLintptr baseOffset) {
+    // Atributos 3-6: matriz de modelo (una columna por atributo)
+    for (int col = 0; col < 4; col++) {
+        glVertexAttribPointer(3 + col, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(baseOffset + offsetof(InstanceData, model) + col * sizeof(glm::vec4)));
+    }
+    // Atributo 7: índice de material (bloque Materials)
+    glVertexAttribIPointer(7, 1, GL_INT, sizeof(InstanceData), (void*)(baseOffset + offsetof(InstanceData, materialIndex)));
+    // Atributos 8-10: matriz normal
+    for (int col = 0; col < 3; col++) {
+        glVertexAttribPointer(8 + col, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            (void*)(baseOffset + offsetof(InstanceData, normalMatrix) + col * sizeof(glm::vec4)));
+    }
+}
+
+// Posiciones de los objetos del móvil (como en tu código original)
+const glm::vec3 mobilePiecePositions[MOBILE_PIECES] = {
+    glm::vec3(2.0f, -2.0f, 0.0f),
+    glm::vec3(-2.0f, -2.0f, 0.0f),
+    glm::vec3(0.0f, -2.0f, 2.0f),
+    glm::vec3(0.0f, -2.0f, -2.0f),
+    glm::vec3(0.0f,  4.0f, 0.0f),
+    glm::vec3(-20.0f, -0.5f, 0.0f),
+    glm::vec3(20.0f, -0.5f, 0.0f),
+    glm::vec3(0.0f, -0.5f, 20.0f),
+    glm::vec3(0.0f, -0.5f, -20.0f),
+    glm::vec3(0.0f, -0.5f, 0.0f),
+    glm::vec3(0.0f, -0.5f, 0.0f),
+    glm::vec3(0.0f,  0.5f, 0.0f)
+};
+const int MOBILE_TOP_PIECE = 4;    // Cubo superior: ahí se apoya el siguiente nivel
+const float NESTED_SCALE = 0.5f;   // Escala de cada móvil anidado respecto a su padre
+
+// Ajuste de escala segun el objeto
+glm::vec3 mobilePieceScale(int piece) {
+    if (piece >= 5 && piece < 9)
+        return glm::vec3(0.1f, 2.0f, 0.1f);
+    if (piece == 9)
+        return glm::vec3(4.0f, 0.1f, 0.1f);
+    if (piece == 10)
+        return glm::vec3(0.1f, 0.1f, 4.0f);
+    if (piece == 11)
+        return glm::vec3(0.1f, 4.0f, 0.1f);
+    return glm::vec3(1.0f);
+}
+
+// Objeto dibujable: un nodo del grafo y su material
+struct SceneObject {
+    NodeId node;
+    int materialIndex;
+};
+
+// Raíz de cada móvil (la que gira) y su nivel de anidamiento
+struct MobileRig {
+    NodeId root;
+    int level;
+};
+
+// Crea un móvil bajo parent y, si quedan niveles, otro más pequeño sobre su
+// cubo superior. Cada pieza es hija de la raíz del móvil: su local es
+// T(escala * posición) * S, equivalente al antiguo scale() seguido de translate().
+void buildMobile(SceneGraph& scene, NodeId parent, const glm::vec3& position, float mobileScale,
+    int level, int levels, std::vector<SceneObject>& objects, std::vector<MobileRig>& rigs) {
+    NodeId root = scene.createNode(parent);
+    scene.setLocal(root, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(mobileScale));
+    rigs.push_back({ root, level });
+    NodeId top = INVALID_NODE;
+    for (int i = 0; i < MOBILE_PIECES; i++) {
+        glm::vec3 pieceScale = mobilePieceScale(i);
+        NodeId piece = scene.createNode(root);
+        scene.setLocal(piece, pieceScale * mobilePiecePositions[i], glm::quat(1.0f, 0.0f, 0.0f, 0.0f), pieceScale);
+        objects.push_back({ piece, i });
+        if (i == MOBILE_TOP_PIECE)
+            top = piece;
+    }
+    // El móvil mide 2.5 por debajo de su raíz: lo apoyamos sobre la cara superior del cubo
+    if (level + 1 < levels)
+        buildMobile(scene, top, glm::vec3(0.0f, 0.5f + 2.5f * NESTED_SCALE, 0.0f), NESTED_SCALE,
+            level + 1, levels, objects, rigs);
+}
+
+// Desplazamiento de cada copia del móvil: se reparten en una cuadrícula centrada
+glm::vec3 mobileOffset(int mobile, int mobileCount) {
+    int side = (int)std::ceil(std::sqrt((float)mobileCount));
+    float half = (side - 1) * 0.5f;
+    return glm::vec3((mobile % side - half) * MOBILE_SPACING, 0.0f, (mobile / side - half) * MOBILE_SPACING);
+}
+
+// Luces de prueba repartidas sobre la caja de la escena (siempre las mismas
+// para una cantidad dada); una de cada cuatro es focal y apunta hacia abajo
+void generatePointLights(std::vector<PointLight>& lights, std::vector<glm::vec3>& anchors,
+    int count, float radius, const Aabb& region) {
+    lights.resize(count);
+    anchors.resize(count);
+    unsigned int seed = 12345u;
+    auto random = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0f;
+    };
+    for (int i = 0; i < count; i++) {
+        PointLight& light = lights[i];
+        anchors[i] = glm::vec3(region.min.x + random() * (region.max.x - region.min.x),
+            region.min.y + 0.5f + random() * 6.0f,
+            region.min.z + random() * (region.max.z - region.min.z));
+        light.position = anchors[i];
+        light.radius = radius;
+        light.color = glm::vec3(0.5f + random(), 0.5f + random(), 0.5f + random()) * 2.0f;
+        light.spot = i % 4 == 3;
+        light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+        light.cosCone = std::cos(glm::radians(35.0f));
+    }
+}
+
+// --bench transforms: composición de 100k matrices T * R * S. Compara la
+// cadena de glm por objeto con los kernels en lote sobre datos SoA.
+// Solo usa la CPU, así que corre sin ventana ni contexto GL.
+int runTransformBenchmark() {
+    const size_t TRANSFORM_COUNT = 100000;
+    TransformArray transforms;
+    std::srand(1234);
+    auto random = [](float lo, float hi) { return lo + (hi - lo) * (std::rand() / (float)RAND_MAX); };
+    for (size_t i = 0; i < TRANSFORM_COUNT; i++) {
+        glm::vec3 axis = glm::normalize(glm::vec3(random(-1.0f, 1.0f), random(0.1f, 1.0f), random(-1.0f, 1.0f)));
+        transforms.add(glm::vec3(random(-50.0f, 50.0f), random(0.0f, 10.0f), random(-50.0f, 50.0f)),
+            glm::angleAxis(random(0.0f, 6.28f), axis),
+            glm::vec3(random(0.1f, 4.0f), random(0.1f, 4.0f), random(0.1f, 4.0f)));
+    }
+    std::vector<glm::mat4> worlds(TRANSFORM_COUNT);
+
+    Benchmark benchmark;
+    int mode = 0; // -1: glm por objeto, si no el SimdLevel del kernel en lote
+    benchmark.addPhase("glm por objeto", [&]() { mode = -1; });
+    for (int level = SIMD_SCALAR; level <= detectSimdLevel(); level++) {
+        benchmark.addPhase(std::string("SoA en lote (") + simdLevelName((SimdLevel)level) + ")",
+            [&, level]() { mode = level; });
+    }
+    std::cout << "CPU: " << simdLevelName(detectSimdLevel()) << std::endl;
+    while (benchmark.active()) {
+        benchmark.beginFrame();
+        auto start = std::chrono::high_resolution_clock::now();
+        if (mode < 0) {
+            for (size_t i = 0; i < TRANSFORM_COUNT; i++) {
+                glm::mat4 model = scale(transforms.scale(i));
+                model = glm::mat4_cast(transforms.rotation(i)) * model;
+                worlds[i] = glm::translate(glm::mat4(1.0f), transforms.translation(i)) * model;
+            }
+        }
+        else {
+            composeTransforms(transforms, 0, TRANSFORM_COUNT, worlds.data(), sizeof(glm::mat4), (SimdLevel)mode);
+        }
+        benchmark.record("componer 100k (ms)", std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - start).count());
+        benchmark.endFrame();
+    }
+    // Evita que el compilador descarte el trabajo
+    float checksum = 0.0f;
+    for (size_t i = 0; i < TRANSFORM_COUNT; i += 1000)
+        checksum += worlds[i][3].x;
+    std::cout << "checksum " << checksum << std::endl;
+    return 0;
+}
+
+// --bench bvh: mantener la BVH con el máximo de móviles girando,
+// reconstruyéndola cada frame o reajustándola, y el costo de las consultas
+// frente al culling plano. "SAH relativo" y "peor nodo" miden cuánto se
+// degrada el árbol reajustado (su máximo es el peor caso del recorrido).
+int runBvhBenchmark() {
+    SceneGraph scene;
+    std::vector<SceneObject> objects;
+    std::vector<MobileRig> rigs;
+    for (int mobile = 0; mobile < MAX_MOBILES; mobile++)
+        buildMobile(scene, INVALID_NODE, mobileOffset(mobile, MAX_MOBILES), 1.0f, 0, 1, objects, rigs);
+    Aabb cubeBounds = computeBounds(cubeVertices, sizeof(cubeVertices) / (8 * sizeof(float)), 8);
+    std::vector<glm::mat4> models(objects.size());
+    BoundsArray bounds;
+    bounds.resize(objects.size());
+    std::vector<uint8_t> visible(objects.size());
+    // Misma cámara inicial que la escena interactiva
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -18.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    Frustum frustum = extractFrustum(projection * view);
+
+    Benchmark benchmark;
+    int mode = 0; // 0: reconstruir, 1: reajustar, 2: culling plano
+    const char* names[] = { "BVH reconstruida cada frame", "BVH reajustada (refit)", "culling plano" };
+    for (int phase = 0; phase < 3; phase++)
+        benchmark.addPhase(names[phase], [&, phase]() { mode = phase; });
+    Bvh bvh;
+    int frame = 0;
+    std::cout << objects.size() << " objetos" << std::endl;
+    while (benchmark.active()) {
+        benchmark.beginFrame();
+        // Giro de 0.05 rad por frame: varias vueltas durante la medición
+        float angle = frame++ * 0.05f;
+        for (const MobileRig& rig : rigs)
+            scene.setRotation(rig.root, glm::angleAxis(angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        scene.update();
+        for (size_t obj = 0; obj < objects.size(); obj++)
+            models[obj] = scene.world(objects[obj].node);
+        transformBounds(cubeBounds, models.data(), sizeof(glm::mat4), 0, objects.size(), bounds);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        if (mode == 0 || bvh.empty())
+            bvh.build(bounds);
+        else if (mode == 1)
+            bvh.refit(bounds);
+        auto updated = std::chrono::high_resolution_clock::now();
+        if (mode == 2)
+            cullBounds(bounds, 0, objects.size(), frustum, visible.data());
+        else
+            bvh.queryFrustum(bounds, frustum, visible.data());
+        auto queried = std::chrono::high_resolution_clock::now();
+
+        if (mode != 2) {
+            benchmark.record("actualizar BVH (ms)", std::chrono::duration<double, std::milli>(updated - start).count());
+            benchmark.record("SAH relativo", bvh.quality().sahRatio);
+            benchmark.record("peor nodo (área)", bvh.quality().worstInflation);
+        }
+        benchmark.record("consulta frustum (ms)", std::chrono::duration<double, std::milli>(queried - updated).count());
+        benchmark.endFrame();
+    }
+    return 0;
+}
+
+// Mallas de la escena en un solo VBO/IBO: desde el paquete, si las tiene
+// (se suben directamente desde la proyección del archivo), o construidas
+// a partir de los vértices de este archivo
+Mesh loadSceneMeshes(const AssetPack* pack, std::vector<MeshRange>& ranges) {
+    std::vector<MeshView> views(MESH_COUNT);
+    bool packed = pack != nullptr;
+    for (int mesh = 0; mesh < MESH_COUNT && packed; mesh++) {
+        const AssetBlob* blob = pack->find(meshAssetNames[mesh]);
+        packed = blob && readMeshBlob(*blob, views[mesh]);
+        if (blob && !packed)
+            std::cout << "Error al leer " << meshAssetNames[mesh] << " del paquete: se usan las mallas incorporadas" << std::endl;
+    }
+    if (packed)
+        return uploadMeshes(views, ranges);
+    return uploadMeshes({
+        buildIndexedMesh(cubeVertices, sizeof(cubeVertices) / (8 * sizeof(float))),
+        buildIndexedMesh(planeVertices, sizeof(planeVertices) / (8 * sizeof(float))) }, ranges);
+}
+
+// --pack [salida]: junta en un paquete las texturas de la escena (la
+// versión .ktx2 si ya se cocinó, y la imagen original) y sus mallas
+bool packAssets(const std::string& output) {
+    std::vector<AssetSource> assets;
+    auto addFile = [&](const std::string& path, AssetKind kind) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        AssetSource asset;
+        asset.name = path;
+        asset.kind = kind;
+        asset.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        assets.push_back(std::move(asset));
+        return true;
+    };
+    for (const char* texture : textureFiles) {
+        addFile(cookedTexturePath(texture), ASSET_KTX2);
+        if (!addFile(texture, ASSET_IMAGE)) {
+            std::cout << "Error al empaquetar " << texture << ": no se pudo leer" << std::endl;
+            return false;
+        }
+    }
+    const MeshData meshes[MESH_COUNT] = {
+        buildIndexedMesh(cubeVertices, sizeof(cubeVertices) / (8 * sizeof(float))),
+        buildIndexedMesh(planeVertices, sizeof(planeVertices) / (8 * sizeof(float))) };
+    for (int mesh = 0; mesh < MESH_COUNT; mesh++) {
+        if (meshes[mesh].indices.empty()) {
+            std::cout << "Error al empaquetar " << meshAssetNames[mesh] << ": malla vacía" << std::endl;
+            return false;
+        }
+        AssetSource asset;
+        asset.name = meshAssetNames[mesh];
+        asset.kind = ASSET_MESH;
+        asset.bytes = meshBlob(meshes[mesh]);
+        assets.push_back(std::move(asset));
+    }
+    if (!writeAssetPack(output, assets))
+        return false;
+    std::cout << assets.size() << " recursos empaquetados en " << output << std::endl;
+    return true;
+}
+
+// --bench startup: tiempo hasta tener todas las texturas y mallas de la
+// escena en la GPU, desde archivos sueltos o desde el paquete. Cada
+// iteración abre el paquete y sube todo de nuevo; el grupo de hilos ya
+// está creado. Con la caché de páginas caliente en ambos casos.
+int runStartupBenchmark() {
+    ThreadPool pool;
+    pool.create();
+    Benchmark benchmark;
+    benchmark.warmupFrames = 3;
+    benchmark.measureFrames = 20;
+    bool usePack = false;
+    benchmark.addPhase("archivos sueltos", [&]() { usePack = false; });
+    AssetPack probe;
+    if (probe.open(ASSET_PACK_PATH))
+        benchmark.addPhase("paquete", [&]() { usePack = true; });
+    else
+        std::cout << "No se encontró " << ASSET_PACK_PATH << " (generarlo con --pack)" << std::endl;
+    probe.close();
+    while (benchmark.active()) {
+        benchmark.beginFrame();
+        auto start = std::chrono::high_resolution_clock::now();
+        AssetPack pack;
+        if (usePack)
+            pack.open(ASSET_PACK_PATH);
+        TextureLoader loader;
+        loader.create(pool, (size_t)-1);
+        loader.setPack(usePack ? &pack : nullptr);
+        for (const char* texture : textureFiles)
+            loader.load(texture);
+        loader.finish();
+        glFinish();
+        auto texturesDone = std::chrono::high_resolution_clock::now();
+        std::vector<MeshRange> ranges;
+        Mesh meshes = loadSceneMeshes(usePack ? &pack : nullptr, ranges);
+        glFinish();
+        auto meshesDone = std::chrono::high_resolution_clock::now();
+        benchmark.record("texturas (ms)", std::chrono::duration<double, std::milli>(texturesDone - start).count());
+        benchmark.record("mallas (ms)", std::chrono::duration<double, std::milli>(meshesDone - texturesDone).count());
+        benchmark.record("total (ms)", std::chrono::duration<double, std::milli>(meshesDone - start).count());
+        benchmark.record("comprimidas", loader.stats().cooked);
+        meshes.destroy();
+        loader.destroy();
+        benchmark.endFrame();
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // --bench <nombre>: ejecuta un benchmark por fases e imprime los resultados
+    std::string benchName;
+    for (int arg = 1; arg + 1 < argc; arg++) {
+        if (std::string(argv[arg]) == "--bench")
+            benchName = argv[arg + 1];
+    }
+    // --cook [imágenes...]: genera los .ktx2 (por defecto, los de la escena) y sale
+    for (int arg = 1; arg < argc; arg++) {
+        if (std::string(argv[arg]) != "--cook")
+            continue;
+        std::vector<std::string> sources(argv + arg + 1, argv + argc);
+        if (sources.empty())
+            sources.assign(std::begin(textureFiles), std::end(textureFiles));
+        ThreadPool cookWorkers;
+        cookWorkers.create();
+        auto cookStart = std::chrono::high_resolution_clock::now();
+        int failed = cookTextures(sources, cookWorkers);
+        std::cout << sources.size() - failed << " texturas cocinadas en "
+            << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - cookStart).count()
+            << " ms" << std::endl;
+        return failed > 0 ? 1 : 0;
+    }
+    // --pack [salida]: genera el paquete de recursos y sale
+    for (int arg = 1; arg < argc; arg++) {
+        if (std::string(argv[arg]) == "--pack")
+            return packAssets(arg + 1 < argc ? argv[arg + 1] : ASSET_PACK_PATH) ? 0 : 1;
+    }
+    // --loose: ignora el paquete aunque exista
+    bool looseAssets = false;
+    for (int arg = 1; arg < argc; arg++) {
+        if (std::string(argv[arg]) == "--loose")
+            looseAssets = true;
+    }
+    // Benchmarks que solo usan la CPU
+    if (benchName == "transforms")
+        return runTransformBenchmark();
+    if (benchName == "bvh")
+        return runBvhBenchmark();
+
     if (!glfwInit()) return -1;
 
     GLFWwindow* window = glfwCreateWindow(1400, 1200, "Móvil con Luces y Sombras", NULL, NULL);
@@ -267,6 +1152,13 @@ int main() {
     glfwMakeContextCurrent(window);
     glewExperimental = GL_TRUE;
     glewInit();
+    // El benchmark de arranque solo necesita el contexto
+    if (benchName == "startup") {
+        int result = runStartupBenchmark();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return result;
+    }
 
     // Configuración de Dear ImGui
     IMGUI_CHECKVERSION();
@@ -281,111 +1173,143 @@ int main() {
     glEnable(GL_DEPTH_TEST);
 
     // --- COMPILACIÓN DE SHADERS ---
-    auto compileShader = [&](GLenum type, const char* source) -> GLuint {
-        GLuint shader = glCreateShader(type);
-        glShaderSource(shader, 1, &source, NULL);
-        glCompileShader(shader);
-        int success;
-        char infoLog[512];
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 512, NULL, infoLog);
-            std::cout << "Error al compilar shader: " << infoLog << std::endl;
-        }
-        return shader;
-    };
-
     // Programa principal (iluminación y sombras)
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    int success;
-    char infoLog[512];
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cout << "Error al enlazar programa principal: " << infoLog << std::endl;
-    }
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Con GL 4.3 las listas de luces se leen de shader storage buffers
+    bool lightStorageBuffers = GLEW_VERSION_4_3 != 0;
+    std::string fragmentHeader = std::string(lightStorageBuffers ? "#version 430 core\n#define LIGHT_LIST_SSBO\n" : "#version 330 core\n")
+        + "#define CLUSTER_X " + std::to_string(CLUSTER_X) + "\n#define CLUSTER_Y " + std::to_string(CLUSTER_Y)
+        + "\n#define CLUSTER_Z " + std::to_string(CLUSTER_Z) + "\n";
+    ShaderProgram shaderProgram;
+    shaderProgram.build(vertexShaderSource,
+        (fragmentHeader + materialShaderSource + lightingShaderSource + fragmentShaderSource).c_str(), "principal");
+    shaderProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shaderProgram.bindUniformBlock("Materials", MATERIALS_BINDING);
+    SurfaceUniforms litSurface(shaderProgram);
+    LightingUniforms litLighting(shaderProgram);
+    // Unidades de textura: 0 para el arreglo de materiales; el resto, ver LightingUniforms
+    shaderProgram.use();
+    shaderProgram.uniform<int>("materialLayers").set(0);
+
+    // Renderizado diferido: el G-buffer solo necesita los materiales y la
+    // pasada de iluminación solo la parte de luces y sombras
+    ShaderProgram gbufferProgram;
+    gbufferProgram.build(vertexShaderSource,
+        (std::string("#version 330 core\n") + materialShaderSource + gbufferFragmentShaderSource).c_str(), "del G-buffer");
+    gbufferProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    gbufferProgram.bindUniformBlock("Materials", MATERIALS_BINDING);
+    SurfaceUniforms gbufferSurface(gbufferProgram);
+    gbufferProgram.use();
+    gbufferProgram.uniform<int>("materialLayers").set(0);
+
+    ShaderProgram deferredProgram;
+    deferredProgram.build(deferredVertexShaderSource,
+        (fragmentHeader + lightingShaderSource + deferredFragmentShaderSource).c_str(), "de iluminación diferida");
+    deferredProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    LightingUniforms deferredLighting(deferredProgram);
+    Uniform<glm::mat4> deferredInverseViewProjection = deferredProgram.uniform<glm::mat4>("inverseViewProjection");
+    // El G-buffer ocupa las unidades de los materiales, que esta pasada no usa
+    deferredProgram.use();
+    deferredProgram.uniform<int>("gAlbedo").set(0);
+    deferredProgram.uniform<int>("gNormal").set(1);
+    deferredProgram.uniform<int>("gDepth").set(2);
+    int renderPath = RENDER_FORWARD;
+    GBuffer gbuffer;
+    GLuint fullscreenVAO;
+    glGenVertexArrays(1, &fullscreenVAO);
 
     // Programa de profundidad (para shadow mapping)
-    GLuint depthVertexShader = compileShader(GL_VERTEX_SHADER, depthVertexShaderSource);
-    GLuint depthFragmentShader = compileShader(GL_FRAGMENT_SHADER, depthFragmentShaderSource);
-    GLuint depthShaderProgram = glCreateProgram();
-    glAttachShader(depthShaderProgram, depthVertexShader);
-    glAttachShader(depthShaderProgram, depthFragmentShader);
-    glLinkProgram(depthShaderProgram);
-    glGetProgramiv(depthShaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(depthShaderProgram, 512, NULL, infoLog);
-        std::cout << "Error al enlazar programa de profundidad: " << infoLog << std::endl;
-    }
-    glDeleteShader(depthVertexShader);
-    glDeleteShader(depthFragmentShader);
-
-    // --- CONFIGURACIÓN DE BUFFERS PARA EL CUBO ---
-    GLuint cubeVAO, cubeVBO;
-    glGenVertexArrays(1, &cubeVAO);
-    glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-    // Atributo 0: posición
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Atributo 1: normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Atributo 2: coord. de textura
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    ShaderProgram depthShaderProgram;
+    depthShaderProgram.build(depthVertexShaderSource, depthGeometryShaderSource, depthFragmentShaderSource, "de profundidad");
+    depthShaderProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    Uniform<glm::mat4> depthModel = depthShaderProgram.uniform<glm::mat4>("model");
+    Uniform<bool> depthUseInstancing = depthShaderProgram.uniform<bool>("useInstancing");
+    Uniform<int> depthCascadeMask = depthShaderProgram.uniform<int>("cascadeMask");
+
+    // Programa de la pre-pasada de profundidad (sin color)
+    ShaderProgram prepassProgram;
+    prepassProgram.build(prepassVertexShaderSource, depthFragmentShaderSource, "de pre-pasada");
+    prepassProgram.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    SurfaceUniforms prepassSurface(prepassProgram);
 
-    // --- CONFIGURACIÓN DE BUFFERS PARA EL PISO (plano) ---
-    GLuint planeVAO, planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-    // Posición
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // TexCoord
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    // --- GEOMETRÍA COMPARTIDA (CUBO Y PISO) ---
+    // Mallas indexadas (el cubo con 24 vértices únicos en lugar de 36) con
+    // vértices compactos, en un solo VBO/IBO: no hay cambios de VAO entre
+    // mallas y cada una es un rango apto para comandos indirectos
+    // Paquete de recursos (--pack): mallas y texturas salen de un solo
+    // archivo proyectado en memoria; si no está, de los archivos sueltos
+    AssetPack assetPack;
+    const AssetPack* scenePack = !looseAssets && assetPack.open(ASSET_PACK_PATH) ? &assetPack : nullptr;
+    std::vector<MeshRange> meshRanges;
+    Mesh sceneMesh = loadSceneMeshes(scenePack, meshRanges);
+    const MeshRange cubeRange = meshRanges[MESH_CUBE];
+    const MeshRange planeRange = meshRanges[MESH_PLANE];
+    GLuint sceneVAO = sceneMesh.vao;
+    glBindVertexArray(sceneVAO);
+    // Atributos por instancia: viven en el anillo de streaming y se
+    // reapuntan cada frame al slice actual (ver setInstanceAttributes)
+    for (int attribute = 3; attribute <= 10; attribute++) {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
     glBindVertexArray(0);
 
+    // --- BUFFER DE STREAMING (datos dinámicos por frame) ---
+    // Cada slice guarda las instancias visibles de cada pasada (sombras y
+    // cámara), con multi-draw también el piso y los comandos indirectos de
+    // cada una, y el bloque FrameData de un frame, más el relleno de
+    // alineación de cada reserva
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    GLsizeiptr streamSliceSize = 2 * (MAX_MOBILES * MOBILE_PIECES + 2) * sizeof(InstanceData)
+        + 2 * MESH_COUNT * sizeof(DrawElementsIndirectCommand) + sizeof(FrameUniforms)
+        + 2 * sizeof(InstanceData) + 2 * sizeof(GLuint) + 2 * uniformAlignment;
+    int streamSlices = 3;
+    StreamBuffer frameStream;
+    frameStream.create(streamSliceSize, streamSlices);
+
+    // Multi-draw indirect (GL 4.3): con instancing, cada pasada se envía con
+    // un solo glMultiDrawElementsIndirect, un comando por malla. El piso va
+    // como una instancia más después de los cubos y su comando la elige con
+    // baseInstance, así los datos por objeto llegan por los mismos atributos
+    // por instancia.
+    bool multiDrawSupported = GLEW_VERSION_4_3 != 0;
+    bool multiDraw = multiDrawSupported;
+    InstanceData floorInstance = {};
+    floorInstance.model = glm::mat4(1.0f);
+    floorInstance.materialIndex = FLOOR_MATERIAL;
+    for (int col = 0; col < 3; col++)
+        floorInstance.normalMatrix[col] = glm::vec4(glm::mat3(1.0f)[col], 0.0f);
+
     // --- CARGA DE TEXTURAS ---
-    std::vector<unsigned int> textures;
-    textures.push_back(loadTexture("textures/wood.jpg"));     // índice 0
-    textures.push_back(loadTexture("textures/metal.jpg"));    // índice 1
-    textures.push_back(loadTexture("textures/concrete.jpg")); // índice 2
-    textures.push_back(loadTexture("textures/grass.jpeg"));   // índice 3
-    textures.push_back(loadTexture("textures/stone.jpeg"));    // índice 4
-
-    // Posiciones de los objetos del móvil (como en tu código original)
-    glm::vec3 posiciones[12] = {
-        glm::vec3(2.0f, -2.0f, 0.0f),
-        glm::vec3(-2.0f, -2.0f, 0.0f),
-        glm::vec3(0.0f, -2.0f, 2.0f),
-        glm::vec3(0.0f, -2.0f, -2.0f),
-        glm::vec3(0.0f,  4.0f, 0.0f),
-        glm::vec3(-20.0f, -0.5f, 0.0f),
-        glm::vec3(20.0f, -0.5f, 0.0f),
-        glm::vec3(0.0f, -0.5f, 20.0f),
-        glm::vec3(0.0f, -0.5f, -20.0f),
-        glm::vec3(0.0f, -0.5f, 0.0f),
-        glm::vec3(0.0f, -0.5f, 0.0f),
-        glm::vec3(0.0f,  0.5f, 0.0f)
-    };
+    // El grupo de hilos decodifica las imágenes en paralelo y el bucle
+    // principal las sube por partes (textureUploadMB por frame); mientras
+    // tanto se dibuja con una textura provisoria. Después, el mismo grupo
+    // reparte el culling y las luces de cada frame.
+    ThreadPool workers;
+    workers.create();
+    int textureUploadMB = 4;
+    TextureLoader textureLoader;
+    textureLoader.create(workers, (size_t)textureUploadMB << 20);
+    textureLoader.setPack(scenePack);
+    // La caché comparte las texturas por ruta y por contenido, y guarda
+    // las que quedan sin usar mientras entren en textureCacheMB
+    int textureCacheMB = 64;
+    TextureCache textureCache;
+    textureCache.create(textureLoader, (size_t)textureCacheMB << 20);
+    // Paleta de materiales: los índices de MultiTextureConfig y
+    // cubeTextures apuntan a estas ranuras, que son las capas del arreglo
+    // de materiales; cada ranura guarda un identificador de la caché
+    int paletteFiles[5] = { 0, 1, 2, 3, 4 };
+    std::vector<int> textures;
+    for (int slot = 0; slot < 5; slot++)
+        textures.push_back(textureCache.acquire(textureFiles[paletteFiles[slot]]));
+    // Arreglo de texturas de materiales: cada ranura se copia a su capa
+    // (reescalada a materialLayerSize) cuando cambia su textura
+    const int materialLayerSizes[] = { 256, 512, 1024, 2048 };
+    int materialLayerSizeIndex = 2;
+    TextureArray materialArray;
+    materialArray.create(materialLayerSizes[materialLayerSizeIndex], (int)textures.size());
+    double firstFrameMs = -1.0;
 
     // Configuración de multitextura para cada objeto (igual que en tu código)
     int cubeTextures[12] = { 0, 1, 2, 3, 4, 0, 1, 2, 3, 0, 1, 2 };
@@ -408,37 +1332,290 @@ int main() {
     multiTexConfigs[2].useMultiTexture = true;
 
     // --- CONFIGURACIÓN DEL SHADOW MAPPING ---
-    const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-    GLuint depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    GLuint depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0,
-        GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Cascadas: un arreglo de mapas de profundidad, uno por trozo del
+    // frustum de la cámara. Se recrea al cambiar la cantidad o la resolución.
+    // Cada proyección se ajusta a la caja de la escena (no se gastan texels
+    // en espacio vacío) y se alinea a la grilla de texels de la luz
+    const int shadowResolutions[] = { 512, 1024, 2048, 4096 };
+    int shadowResolutionIndex = 1;
+    int cascadeCount = 3;
+    float shadowDistance = 60.0f;
+    float cascadeSplitLambda = 0.75f;
+    bool snapCascades = true;
+    bool showCascades = false;
+    int shadowFilter = SHADOW_FILTER_PCF;
+    int pcfRadius = 1;          // 3x3
+    float poissonRadius = 2.0f; // texels
+    // VSM/EVSM: momentos desenfocados a resolución reducida, solo para las
+    // cascadas que se volvieron a dibujar
+    ShadowMomentArray shadowMoments;
+    int momentDownsampleIndex = 1; // 1, 2 o 4
+    int momentBlurRadius = 2;
+    int builtBlurRadius = -1;
+    // Cascadas redibujadas mientras el filtro no usaba momentos: se
+    // recalculan al volver a VSM/EVSM
+    unsigned int staleMomentLayers = 0;
+    float lightBleedReduction = 0.3f;
+    ShadowMapArray shadowMaps;
+    // Si el framebuffer de sombras no queda completo se baja la resolución;
+    // sin ninguna que funcione no se puede dibujar la escena
+    auto createShadowMaps = [&]() {
+        while (!shadowMaps.create(shadowResolutions[shadowResolutionIndex], cascadeCount)) {
+            if (shadowResolutionIndex == 0)
+                return false;
+            shadowResolutionIndex--;
+        }
+        return true;
+    };
+    if (!createShadowMaps()) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return -1;
+    }
+    // Las cascadas cuyo contenido no cambió no se vuelven a dibujar
+    ShadowCache shadowCache;
+    bool shadowCaching = true;
 
     glClearColor(0.6f, 0.8f, 1.0f, 1.0f);
 
     // --- Parámetros de luz ---
     glm::vec3 lightDir = glm::normalize(glm::vec3(-0.2f, -1.0f, -0.3f));
 
+    // --- Parámetros de renderizado ---
+    bool useInstancing = true;
+    bool cpuNormalMatrices = true;
+    bool vertexStageOnly = false; // descarta la rasterización de la pasada 2 (solo benchmarks)
+    int mobileCount = 1;
+    int nestingLevels = 1;      // móviles apilados en cada copia (1 = sin anidar)
+    bool animateMobiles = true;
+    std::vector<InstanceData> instances;
+    instances.reserve(MAX_MOBILES * MOBILE_PIECES);
+    double normalMatrixMs = 0.0;
+    bool normalsCurrent = false;
+
+    // --- GRAFO DE ESCENA ---
+    // Se reconstruye solo cuando cambia la cantidad de móviles o de niveles
+    SceneGraph scene;
+    std::vector<SceneObject> sceneObjects;
+    std::vector<MobileRig> mobileRigs;
+    int builtMobiles = 0, builtLevels = 0;
+    int updatedNodes = 0;
+
+    // --- CULLING POR FRUSTUM ---
+    // Caja local del cubo; las cajas de mundo se recalculan solo cuando
+    // cambian las matrices y se prueban contra la cámara y contra la luz
+    Aabb cubeBounds = computeBounds(cubeVertices, sizeof(cubeVertices) / (8 * sizeof(float)), 8);
+    BoundsArray worldBounds;
+    Aabb floorBounds = computeBounds(planeVertices, sizeof(planeVertices) / (8 * sizeof(float)), 8);
+    Aabb sceneBounds = floorBounds;
+    std::vector<uint8_t> cameraVisible, lightVisible, cascadeVisible;
+    std::vector<int> cameraObjects, shadowObjects; // índices que sobreviven en cada pasada
+    int cullingMode = CULLING_BVH;
+    double cullingMs = 0.0;
+    // Jerarquía sobre las mismas cajas: se reajusta cada frame y se
+    // reconstruye solo cuando cambia la escena o se degrada demasiado
+    Bvh bvh;
+    bool bvhStale = true;
+    int bvhRebuilds = 0;
+    double bvhUpdateMs = 0.0;
+    // Culling por oclusión contra la profundidad del frame anterior (Hi-Z en
+    // la GPU, GL 4.3). Solo filtra la pasada 2 instanciada: las sombras no,
+    // porque un objeto tapado para la cámara puede proyectar una sombra visible.
+    HiZCulling hizCulling;
+    bool occlusionSupported = GLEW_VERSION_4_3 && hizCulling.create();
+    bool occlusionCulling = false;
+    int pickedObject = -1;
+    float pickedDistance = 0.0f;
+    const size_t CULL_BATCH = 2048; // objetos mínimos por hilo
+
+    // --- LUCES PUNTUALES (CLUSTERED FORWARD) ---
+    // Se regeneran al cambiar la cantidad o el radio y se reparten entre
+    // los clusters de la cámara cada frame
+    std::vector<PointLight> pointLights;
+    std::vector<glm::vec3> pointLightAnchors;
+    int pointLightCount = 0;
+    float pointLightRadius = 4.0f;
+    bool animateLights = true;
+    int builtLightCount = -1;
+    float builtLightRadius = 0.0f;
+    LightClusters lightClusters;
+    lightClusters.create(lightStorageBuffers);
+
+    // --- CONTROL DE OVERDRAW ---
+    // Pre-pasada de profundidad: la pasada 2 solo sombrea el fragmento
+    // visible de cada píxel (prueba GL_EQUAL o GL_LEQUAL, sin escribir
+    // profundidad). El orden de adelante hacia atrás ayuda aun sin pre-pasada.
+    bool depthPrepass = false;
+    int prepassDepthTest = 0; // 0 = GL_EQUAL, 1 = GL_LEQUAL
+    bool sortFrontToBack = true;
+    std::vector<std::pair<float, int>> sortKeys;
+    double sortMs = 0.0;
+
+    // --- MEDICIÓN ---
+    GpuTimer depthPassTimer, momentPassTimer, litPassTimer;
+    depthPassTimer.create();
+    momentPassTimer.create();
+    litPassTimer.create();
+    // Muestras que pasan la prueba de profundidad en cada pasada de la cámara
+    SampleCounter prepassSamples, litSamples;
+    prepassSamples.create();
+    litSamples.create();
+    Benchmark benchmark;
+    if (benchName == "normals") {
+        // Costo de la etapa de vértices con ~10k objetos: inverse() por vértice
+        // frente a la matriz normal calculada por objeto en la CPU
+        for (int cpu = 0; cpu < 2; cpu++) {
+            benchmark.addPhase(cpu ? "matriz normal en CPU (SSE)" : "inverse() en el vertex shader", [&, cpu]() {
+                mobileCount = 834;
+                nestingLevels = 1;
+                animateMobiles = true;
+                useInstancing = true;
+                cpuNormalMatrices = cpu != 0;
+                vertexStageOnly = true;
+            });
+        }
+    }
+    else if (benchName == "shadows") {
+        // Costo de fragmentos de cada filtro de sombras: escena quieta para
+        // que la caché evite la pasada de profundidad y solo cambie la pasada 2
+        struct FilterPhase { int filter; int radius; };
+        const FilterPhase filterPhases[] = {
+            { SHADOW_FILTER_HARD, 0 }, { SHADOW_FILTER_HARDWARE, 0 },
+            { SHADOW_FILTER_PCF, 1 }, { SHADOW_FILTER_PCF, 2 }, { SHADOW_FILTER_PCF, 3 },
+            { SHADOW_FILTER_POISSON, 0 },
+            // En VSM/EVSM el radio es el del desenfoque: no cambia el costo por fragmento
+            { SHADOW_FILTER_VSM, 2 }, { SHADOW_FILTER_VSM, 8 }, { SHADOW_FILTER_EVSM, 2 },
+        };
+        for (const FilterPhase& phase : filterPhases) {
+            int taps = phase.filter == SHADOW_FILTER_PCF ? (2 * phase.radius + 1) * (2 * phase.radius + 1)
+                : phase.filter == SHADOW_FILTER_POISSON ? 16 : 1;
+            std::string name = std::string(shadowFilterName((ShadowFilter)phase.filter)) + ", " + std::to_string(taps) + " muestras";
+            if (phase.filter == SHADOW_FILTER_VSM || phase.filter == SHADOW_FILTER_EVSM)
+                name += ", desenfoque " + std::to_string(phase.radius);
+            benchmark.addPhase(name, [&, phase]() {
+                mobileCount = 50;
+                nestingLevels = 1;
+                animateMobiles = false;
+                useInstancing = true;
+                shadowCaching = true;
+                shadowFilter = phase.filter;
+                pcfRadius = std::max(phase.radius, 1);
+                momentBlurRadius = phase.radius;
+            });
+        }
+    }
+    else if (benchName == "lights") {
+        // Tiempo de frame según la cantidad de luces puntuales (1 a 4096)
+        for (int lights = 1; lights <= 4096; lights *= 4) {
+            benchmark.addPhase(std::to_string(lights) + " luces", [&, lights]() {
+                mobileCount = 50;
+                nestingLevels = 1;
+                animateMobiles = false;
+                useInstancing = true;
+                pointLightCount = lights;
+                animateLights = true;
+            });
+        }
+    }
+    else if (benchName == "multidraw") {
+        // Costo de envío en CPU: un draw por objeto, un draw instanciado por
+        // malla y un solo glMultiDrawElementsIndirect por pasada
+        const char* names[] = { "un draw por objeto", "instanciado", "multi-draw indirect" };
+        for (int phase = 0; phase < 3; phase++) {
+            benchmark.addPhase(names[phase], [&, phase]() {
+                mobileCount = 200;
+                nestingLevels = 1;
+                animateMobiles = true;
+                useInstancing = phase > 0;
+                multiDraw = phase == 2;
+                pointLightCount = 0;
+                renderPath = RENDER_FORWARD;
+            });
+        }
+    }
+    else if (benchName == "deferred") {
+        // Forward frente a diferido con muchos cubos superpuestos (el forward
+        // ilumina también los fragmentos que después quedan tapados)
+        for (int lights : { 16, 1024 }) {
+            for (int path = RENDER_FORWARD; path <= RENDER_DEFERRED; path++) {
+                std::string name = std::string(path == RENDER_DEFERRED ? "diferido, " : "forward, ") + std::to_string(lights) + " luces";
+                benchmark.addPhase(name, [&, lights, path]() {
+                    mobileCount = 400;
+                    nestingLevels = 1;
+                    animateMobiles = false;
+                    useInstancing = true;
+                    pointLightCount = lights;
+                    animateLights = true;
+                    renderPath = path;
+                });
+            }
+        }
+    }
+    else if (benchName == "overdraw") {
+        // Pasada 2 forward con muchos cubos superpuestos: sin control de
+        // overdraw, con orden de adelante hacia atrás y con pre-pasada
+        const char* names[] = { "sin orden", "adelante hacia atrás", "pre-pasada GL_EQUAL", "pre-pasada GL_LEQUAL" };
+        for (int phase = 0; phase < 4; phase++) {
+            benchmark.addPhase(names[phase], [&, phase]() {
+                mobileCount = 400;
+                nestingLevels = 1;
+                animateMobiles = false;
+                useInstancing = true;
+                pointLightCount = 256;
+                animateLights = true;
+                renderPath = RENDER_FORWARD;
+                sortFrontToBack = phase > 0;
+                depthPrepass = phase > 1;
+                prepassDepthTest = phase == 3 ? 1 : 0;
+            });
+        }
+    }
+    else if (benchName == "occlusion") {
+        // Escena densa: la pasada 2 con y sin culling por oclusión
+        for (int occlusion = 0; occlusion < 2; occlusion++) {
+            benchmark.addPhase(occlusion ? "con oclusión Hi-Z" : "solo frustum", [&, occlusion]() {
+                mobileCount = 2048;
+                nestingLevels = 1;
+                animateMobiles = false;
+                useInstancing = true;
+                pointLightCount = 256;
+                animateLights = true;
+                renderPath = RENDER_FORWARD;
+                occlusionCulling = occlusion != 0;
+            });
+        }
+    }
+    else if (!benchName.empty()) {
+        std::cout << "Benchmark desconocido: " << benchName << std::endl;
+    }
+    if (benchmark.active())
+        glfwSwapInterval(0);
+
+    // --- UNIFORM BUFFERS ---
+    // Materiales: uno por pieza del móvil más el piso; solo se suben al cambiar
+    UniformBuffer materialUBO;
+    materialUBO.create(MAX_MATERIALS * sizeof(MaterialUniforms), MATERIALS_BINDING);
+    std::vector<MaterialUniforms> materials(FLOOR_MATERIAL + 1);
+    std::vector<MaterialUniforms> uploadedMaterials;
+
     // Bucle principal
     while (!glfwWindowShouldClose(window)) {
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // Texturas decodificadas: se suben dentro del presupuesto del frame
+        textureLoader.setFrameBudget((size_t)textureUploadMB << 20);
+        textureLoader.update();
+        textureCache.setBudget((size_t)textureCacheMB << 20);
+        textureCache.update();
+        for (int slot = 0; slot < (int)textures.size(); slot++)
+            materialArray.setLayer(slot, textureCache.texture(textures[slot]), textureCache.generation(textures[slot]));
+        materialArray.update();
+
         // Control de cámara 
         if (ImGui::IsKeyDown(ImGuiKey_W))
             wasd_Movement.y -= movementSpeed * deltaTime;
@@ -468,118 +1645,557 @@ int main() {
 
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
 
+        // Grafo de escena: una raíz por copia del móvil, con los niveles anidados debajo
+        mobileCount = std::min(mobileCount, MAX_MOBILES / nestingLevels);
+        bool rebuilt = mobileCount != builtMobiles || nestingLevels != builtLevels;
+        if (rebuilt) {
+            scene.clear();
+            sceneObjects.clear();
+            mobileRigs.clear();
+            for (int mobile = 0; mobile < mobileCount; mobile++)
+                buildMobile(scene, INVALID_NODE, mobileOffset(mobile, mobileCount), 1.0f, 0, nestingLevels, sceneObjects, mobileRigs);
+            builtMobiles = mobileCount;
+            builtLevels = nestingLevels;
+            pickedObject = -1;
+        }
+        // Solo giran las raíces; sus piezas y los niveles anidados heredan el giro
+        if (animateMobiles || rebuilt) {
+            float angle = currentFrame * 0.4f;
+            for (const MobileRig& rig : mobileRigs) {
+                float direction = (rig.level % 2) ? -2.0f : 1.0f;
+                scene.setRotation(rig.root, glm::angleAxis(angle * direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+            }
+        }
+        updatedNodes = scene.update();
+
+        // Transformaciones de todos los cubos (compartidas por ambas pasadas):
+        // solo se copian las matrices de mundo que cambiaron en este frame
+        int objectCount = (int)sceneObjects.size();
+        instances.resize(objectCount);
+        bool instancesChanged = rebuilt || updatedNodes > 0;
+        if (instancesChanged) {
+            for (int obj = 0; obj < objectCount; obj++) {
+                const SceneObject& object = sceneObjects[obj];
+                if (rebuilt || scene.changed(object.node)) {
+                    instances[obj].model = scene.world(object.node);
+                    instances[obj].materialIndex = object.materialIndex;
+                }
+            }
+            normalsCurrent = false;
+        }
+        // Matrices normales en lote (una por objeto en lugar de una inversa por vértice)
+        if (cpuNormalMatrices && !normalsCurrent) {
+            auto normalStart = std::chrono::high_resolution_clock::now();
+            computeNormalMatrices(&instances[0].model, sizeof(InstanceData),
+                instances[0].normalMatrix, sizeof(InstanceData), objectCount);
+            normalMatrixMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - normalStart).count();
+            normalsCurrent = true;
+        }
+        // Cascadas de sombra ajustadas a trozos del frustum de la cámara
+        if (shadowMaps.layers() != cascadeCount || shadowMaps.resolution() != shadowResolutions[shadowResolutionIndex]) {
+            if (!createShadowMaps())
+                break;
+            shadowCache.invalidate();
+        }
+        if (rebuilt || !shadowCaching)
+            shadowCache.invalidate();
+
+        // Cajas de mundo: cada hilo procesa un bloque de objetos
+        auto cullStart = std::chrono::high_resolution_clock::now();
+        worldBounds.resize(objectCount);
+        cameraVisible.resize(objectCount);
+        lightVisible.resize(objectCount);
+        cascadeVisible.resize(objectCount);
+        if (instancesChanged) {
+            workers.parallelFor(objectCount, CULL_BATCH, [&](size_t begin, size_t end) {
+                transformBounds(cubeBounds, &instances[0].model, sizeof(InstanceData), begin, end, worldBounds);
+            });
+            bvhStale = true;
+            // Caja de la escena (cubos + piso) para ajustar las cascadas
+            Aabb cubesBox = mergeBounds(worldBounds, 0, objectCount);
+            sceneBounds.min = glm::min(cubesBox.min, floorBounds.min);
+            sceneBounds.max = glm::max(cubesBox.max, floorBounds.max);
+        }
+        CascadeCamera cascadeCamera = { view, glm::radians(45.0f), 800.0f / 600.0f, 0.1f };
+        ShadowCascades cascades = fitShadowCascades(cascadeCamera, lightDir, cascadeCount,
+            shadowDistance, cascadeSplitLambda, sceneBounds, shadowMaps.resolution(), snapCascades);
+
+        // Luces puntuales: se mueven en círculos alrededor de su ancla
+        if (rebuilt || builtLightCount != pointLightCount || builtLightRadius != pointLightRadius) {
+            generatePointLights(pointLights, pointLightAnchors, pointLightCount, pointLightRadius, sceneBounds);
+            builtLightCount = pointLightCount;
+            builtLightRadius = pointLightRadius;
+        }
+        if (animateLights) {
+            for (int i = 0; i < pointLightCount; i++) {
+                float phase = currentFrame * (0.5f + (i % 7) * 0.1f) + i;
+                pointLights[i].position = pointLightAnchors[i] + glm::vec3(std::cos(phase), 0.0f, std::sin(phase)) * 1.5f;
+            }
+        }
+        if (pointLightCount > 0) {
+            lightClusters.setProjection(projection, 0.1f, 100.0f);
+            lightClusters.update(pointLights, view, workers);
+        }
+        // La BVH también se usa para el picking, así que se actualiza bajo demanda
+        bool bvhRebuild = rebuilt;
+        auto updateBvh = [&]() {
+            auto bvhStart = std::chrono::high_resolution_clock::now();
+            if (bvhRebuild || bvh.primitiveCount() != objectCount || bvh.quality().sahRatio > BVH_REBUILD_RATIO) {
+                bvh.build(worldBounds);
+                bvhRebuilds++;
+                bvhRebuild = false;
+            }
+            else if (bvhStale) {
+                bvh.refit(worldBounds);
+            }
+            bvhStale = false;
+            bvhUpdateMs = std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - bvhStart).count();
+        };
+        Frustum cameraFrustum = extractFrustum(projection * view);
+        // Una caja proyecta sombra si toca cualquiera de las cascadas
+        Frustum cascadeFrusta[MAX_CASCADES];
+        for (int c = 0; c < cascades.count; c++)
+            cascadeFrusta[c] = extractFrustum(cascades.lightSpace[c]);
+        if (cullingMode == CULLING_FLAT) {
+            workers.parallelFor(objectCount, CULL_BATCH, [&](size_t begin, size_t end) {
+                cullBounds(worldBounds, begin, end, cameraFrustum, cameraVisible.data());
+                cullBounds(worldBounds, begin, end, cascadeFrusta, cascades.count, lightVisible.data());
+            });
+        }
+        else if (cullingMode == CULLING_BVH) {
+            updateBvh();
+            // Las dos consultas son independientes: una por hilo
+            workers.parallelFor(2, 1, [&](size_t begin, size_t end) {
+                for (size_t query = begin; query < end; query++) {
+                    if (query == 0)
+                        bvh.queryFrustum(worldBounds, cameraFrustum, cameraVisible.data());
+                    else {
+                        bvh.queryFrustum(worldBounds, cascadeFrusta[0], lightVisible.data());
+                        for (int c = 1; c < cascades.count; c++) {
+                            bvh.queryFrustum(worldBounds, cascadeFrusta[c], cascadeVisible.data());
+                            for (int obj = 0; obj < objectCount; obj++)
+                                lightVisible[obj] |= cascadeVisible[obj] << c;
+                        }
+                    }
+                }
+            });
+        }
+        bool culling = cullingMode != CULLING_OFF;
+
+        // Caché de sombras: firma por cascada con su matriz de luz y con la
+        // versión de cada objeto que la toca (lightVisible tiene un bit por cascada)
+        unsigned int allCascades = (1u << cascades.count) - 1;
+        shadowCache.begin(cascades);
+        if (shadowCaching) {
+            for (int obj = 0; obj < objectCount; obj++) {
+                unsigned int cascadeBits = culling ? lightVisible[obj] : allCascades;
+                for (int c = 0; c < cascades.count; c++) {
+                    if (cascadeBits & (1u << c))
+                        shadowCache.addCaster(c, obj, scene.version(sceneObjects[obj].node));
+                }
+            }
+        }
+        unsigned int dirtyCascades = shadowCache.resolve();
+
+        cameraObjects.clear();
+        shadowObjects.clear();
+        // Visibles para la luz antes de filtrar por cascadas a redibujar
+        // (estadística; la caché de sombras no la cambia)
+        int lightVisibleCount = 0;
+        for (int obj = 0; obj < objectCount; obj++) {
+            if (!culling || cameraVisible[obj])
+                cameraObjects.push_back(obj);
+            if (!culling || lightVisible[obj] != 0)
+                lightVisibleCount++;
+            // A la pasada de sombras solo van los objetos de cascadas a redibujar
+            if ((culling ? lightVisible[obj] : allCascades) & dirtyCascades)
+                shadowObjects.push_back(obj);
+        }
+        cullingMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - cullStart).count();
+
+        // Orden por profundidad de vista del centro de cada caja, de adelante
+        // hacia atrás: así la prueba temprana de profundidad descarta los
+        // fragmentos tapados antes de ejecutar el fragment shader
+        auto sortStart = std::chrono::high_resolution_clock::now();
+        if (sortFrontToBack && cameraObjects.size() > 1) {
+            sortKeys.resize(cameraObjects.size());
+            for (size_t k = 0; k < cameraObjects.size(); k++) {
+                int obj = cameraObjects[k];
+                float depth = -(view[0][2] * worldBounds.cx[obj] + view[1][2] * worldBounds.cy[obj]
+                    + view[2][2] * worldBounds.cz[obj] + view[3][2]);
+                sortKeys[k] = std::make_pair(depth, obj);
+            }
+            std::sort(sortKeys.begin(), sortKeys.end());
+            for (size_t k = 0; k < cameraObjects.size(); k++)
+                cameraObjects[k] = sortKeys[k].second;
+        }
+        sortMs = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - sortStart).count();
+
+        // Picking con clic izquierdo: rayo desde la cámara a través del cursor
+        if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !io.WantCaptureMouse && objectCount > 0) {
+            updateBvh();
+            glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+            float ndcX = 2.0f * io.MousePos.x / io.DisplaySize.x - 1.0f;
+            float ndcY = 1.0f - 2.0f * io.MousePos.y / io.DisplaySize.y;
+            glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+            glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+            glm::vec3 rayOrigin = glm::vec3(nearPoint) / nearPoint.w;
+            glm::vec3 rayDirection = glm::normalize(glm::vec3(farPoint) / farPoint.w - rayOrigin);
+            // Prueba exacta: el rayo se lleva al espacio local del cubo
+            pickedObject = bvh.raycast(rayOrigin, rayDirection,
+                [&](int obj, const glm::vec3& origin, const glm::vec3& direction) {
+                    glm::mat4 toLocal = glm::inverse(instances[obj].model);
+                    glm::vec3 localOrigin = glm::vec3(toLocal * glm::vec4(origin, 1.0f));
+                    glm::vec3 localDirection = glm::vec3(toLocal * glm::vec4(direction, 0.0f));
+                    glm::vec3 t0 = (cubeBounds.min - localOrigin) / localDirection;
+                    glm::vec3 t1 = (cubeBounds.max - localOrigin) / localDirection;
+                    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+                    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+                    float exit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+                    return enter <= exit ? enter : -1.0f;
+                }, pickedDistance);
+        }
+
+        for (int i = 0; i < MOBILE_PIECES; i++) {
+            bool multi = multiTexConfigs[i].useMultiTexture;
+            int flags = (useTextures[i] ? 1 : 0) | (multi ? 2 : 0);
+            if (multi) {
+                materials[i].textures = glm::ivec4(multiTexConfigs[i].texIndex1, multiTexConfigs[i].texIndex2, multiTexConfigs[i].texIndex3, flags);
+                materials[i].mixRatios = glm::vec4(multiTexConfigs[i].mixRatio1, multiTexConfigs[i].mixRatio2, multiTexConfigs[i].mixRatio3, 0.0f);
+            }
+            else {
+                materials[i].textures = glm::ivec4(cubeTextures[i], 0, 0, flags);
+                materials[i].mixRatios = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+            }
+        }
+        // El piso usa la textura de pasto
+        materials[FLOOR_MATERIAL].textures = glm::ivec4(3, 0, 0, 1);
+        materials[FLOOR_MATERIAL].mixRatios = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        if (uploadedMaterials.size() != materials.size() ||
+            memcmp(uploadedMaterials.data(), materials.data(), materials.size() * sizeof(MaterialUniforms)) != 0) {
+            materialUBO.update(materials.data(), materials.size() * sizeof(MaterialUniforms));
+            uploadedMaterials = materials;
+        }
+
+        benchmark.beginFrame();
+
+        // Las instancias visibles de cada pasada se copian al slice actual del
+        // anillo (mapeado de forma persistente). Con instancing desactivado solo
+        // se reserva una entrada para que los atributos por instancia apunten a
+        // memoria válida.
+        frameStream.beginFrame();
+        bool multiDrawActive = multiDraw && multiDrawSupported && useInstancing;
+        // Si algo no cabe en el slice, este frame no dibuja la escena (los
+        // datos quedarían incompletos) y el anillo se agranda al final
+        bool streamFull = false;
+        auto streamInstances = [&](const std::vector<int>& objects) {
+            GLintptr offset = 0;
+            size_t count = useInstancing ? objects.size() : 0;
+            size_t reserved = count + (multiDrawActive ? 1 : 0);
+            InstanceData* dst = (InstanceData*)frameStream.allocate(
+                std::max<size_t>(reserved, 1) * sizeof(InstanceData), sizeof(InstanceData), offset);
+            if (!dst) {
+                streamFull = true;
+                return offset;
+            }
+            for (size_t k = 0; k < count; k++)
+                dst[k] = instances[objects[k]];
+            if (multiDrawActive)
+                dst[count] = floorInstance;
+            return offset;
+        };
+        // Comandos de una pasada: los cubos desde la instancia 0 y el piso
+        // en la instancia que sigue (baseInstance es relativo al inicio de
+        // los atributos, que setInstanceAttributes apunta al bloque de la pasada)
+        auto streamCommands = [&](size_t cubeInstances) {
+            GLintptr offset = 0;
+            if (!multiDrawActive)
+                return offset;
+            DrawElementsIndirectCommand* dst = (DrawElementsIndirectCommand*)frameStream.allocate(
+                MESH_COUNT * sizeof(DrawElementsIndirectCommand), sizeof(GLuint), offset);
+            if (!dst) {
+                streamFull = true;
+                return offset;
+            }
+            dst[MESH_CUBE] = cubeRange.command((GLuint)cubeInstances, 0);
+            dst[MESH_PLANE] = planeRange.command(1, (GLuint)cubeInstances);
+            return offset;
+        };
+        auto drawCommands = [&](GLintptr offset) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, frameStream.id());
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)offset, MESH_COUNT, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        };
+        GLintptr shadowInstanceOffset = streamInstances(shadowObjects);
+        GLintptr cameraInstanceOffset = streamInstances(cameraObjects);
+        GLintptr shadowCommandOffset = streamCommands(shadowObjects.size());
+        GLintptr cameraCommandOffset = streamCommands(cameraObjects.size());
+        int drawCalls = 0;
+
         // --- PASADA 1: RENDERIZADO DEL MAPA DE SOMBRAS ---
-        // Configuramos la cámara de la luz (usamos proyección ortográfica)
-        float near_plane = 1.0f, far_plane = 20.0f;
-        glm::mat4 lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-        glm::mat4 lightView = glm::lookAt(-lightDir * 10.0f, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
-
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
-        glUseProgram(depthShaderProgram);
-        glUniformMatrix4fv(glGetUniformLocation(depthShaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-
-        // Renderizar cada objeto (móvil) en la pasada de profundidad
-        glBindVertexArray(cubeVAO);
-        float angle = currentFrame * 0.4f;
-        for (int i = 0; i < 12; i++) {
-            glm::mat4 model = glm::mat4(1.0f);
-            // Ajuste de escala segun el objeto
-            if (i >= 5 && i < 9)
-                model = scale(glm::vec3(0.1f, 2.0f, 0.1f));
-            else if (i == 9)
-                model = scale(glm::vec3(4.0f, 0.1f, 0.1f));
-            else if (i == 10)
-                model = scale(glm::vec3(0.1f, 0.1f, 4.0f));
-            else if (i == 11)
-                model = scale(glm::vec3(0.1f, 4.0f, 0.1f));
-            model = glm::translate(model, posiciones[i]);
-            model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * model;
-            glUniformMatrix4fv(glGetUniformLocation(depthShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-        // Renderizar el piso (plano)
-        glBindVertexArray(planeVAO);
-        glm::mat4 modelFloor = glm::mat4(1.0f);
-        glUniformMatrix4fv(glGetUniformLocation(depthShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelFloor));
-     
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        // Datos por frame: una sola subida para ambos programas
+        FrameUniforms frameData;
+        frameData.view = view;
+        frameData.projection = projection;
+        for (int c = 0; c < cascades.count; c++) {
+            frameData.lightSpaceMatrices[c] = cascades.lightSpace[c];
+            frameData.cascadeSplits[c] = cascades.splitFar[c];
+            // El bias original estaba pensado para un rango z de 19 (1 a 20)
+            frameData.cascadeBiasScale[c] = 19.0f / cascades.depthRange[c];
+        }
+        frameData.cascadeInfo = glm::ivec4(cascades.count, 0, 0, 0);
+        // Posición de la cámara (para el cálculo especular)
+        frameData.viewPos = glm::vec4(wasd_Movement.x, wasd_Movement.y, -18.0f + wasd_Movement.z, 1.0f);
+        frameData.lightDir = glm::vec4(lightDir, 0.0f);
+        GLintptr frameDataOffset = 0;
+        void* frameDataDst = frameStream.allocate(sizeof(FrameUniforms), uniformAlignment, frameDataOffset);
+        if (frameDataDst) {
+            memcpy(frameDataDst, &frameData, sizeof(FrameUniforms));
+            frameStream.flush();
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameStream.id(), frameDataOffset, sizeof(FrameUniforms));
+        }
+        else {
+            streamFull = true;
+        }
+        if (streamFull) {
+            // Las cascadas que no se dibujan se rehacen en el próximo frame
+            shadowCache.invalidate();
+            dirtyCascades = 0;
+        }
+
+        depthPassTimer.begin();
+        shaderProgram.resetStats();
+        depthShaderProgram.resetStats();
+        if (dirtyCascades) {
+            glViewport(0, 0, shadowMaps.resolution(), shadowMaps.resolution());
+            // Solo se borran y dibujan las cascadas cuya firma cambió
+            shadowMaps.clearLayers(dirtyCascades);
+            glBindFramebuffer(GL_FRAMEBUFFER, shadowMaps.framebuffer());
+            depthShaderProgram.use();
+            depthCascadeMask.set((int)dirtyCascades);
+
+            // Renderizar cada objeto (móvil) dentro del frustum de la luz
+            glBindVertexArray(sceneVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, frameStream.id());
+            setInstanceAttributes(shadowInstanceOffset);
+            if (multiDrawActive) {
+                // Cubos y piso en una sola llamada
+                depthUseInstancing.set(true);
+                drawCommands(shadowCommandOffset);
+                drawCalls++;
+            }
+            else {
+                if (useInstancing) {
+                    depthUseInstancing.set(true);
+                    if (!shadowObjects.empty()) {
+                        drawMeshRange(cubeRange, (GLsizei)shadowObjects.size());
+                        drawCalls++;
+                    }
+                }
+                else {
+                    depthUseInstancing.set(false);
+                    for (int obj : shadowObjects) {
+                        depthModel.set(instances[obj].model);
+                        drawMeshRange(cubeRange);
+                        drawCalls++;
+                    }
+                }
+                // Renderizar el piso (plano)
+                glm::mat4 modelFloor = glm::mat4(1.0f);
+                depthUseInstancing.set(false);
+                depthModel.set(modelFloor);
+                drawMeshRange(planeRange);
+                drawCalls++;
+            }
+        }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        depthPassTimer.end();
+
+        // Momentos de las cascadas que cambiaron (o de todas si cambió la configuración)
+        momentPassTimer.begin();
+        bool momentFilter = shadowFilter == SHADOW_FILTER_VSM || shadowFilter == SHADOW_FILTER_EVSM;
+        if (momentFilter) {
+            int downsample = 1 << momentDownsampleIndex;
+            bool exponential = shadowFilter == SHADOW_FILTER_EVSM;
+            unsigned int momentLayers = dirtyCascades | staleMomentLayers;
+            staleMomentLayers = 0;
+            if (!shadowMoments.matches(shadowMaps.resolution(), shadowMaps.layers(), downsample, exponential)) {
+                shadowMoments.create(shadowMaps.resolution(), shadowMaps.layers(), downsample, exponential);
+                builtBlurRadius = -1;
+            }
+            if (builtBlurRadius != momentBlurRadius) {
+                builtBlurRadius = momentBlurRadius;
+                momentLayers = (1u << shadowMaps.layers()) - 1;
+            }
+            shadowMoments.update(shadowMaps, momentLayers, momentBlurRadius);
+        }
+        else {
+            staleMomentLayers |= dirtyCascades;
+        }
+        momentPassTimer.end();
+
+        // Oclusión: las instancias visibles para la cámara se prueban contra
+        // la pirámide del frame anterior y se compactan para el dibujo indirecto
+        bool occlusionActive = occlusionCulling && occlusionSupported && useInstancing && !streamFull;
+        if (occlusionActive)
+            hizCulling.cull(frameStream.id(), cameraInstanceOffset, (int)cameraObjects.size(), sizeof(InstanceData),
+                cubeBounds, cubeRange);
+        else
+            hizCulling.invalidate();
 
         // --- PASADA 2: RENDERIZADO DE LA ESCENA CON SOMBRAS ---
         int display_w, display_h;
         glfwGetFramebufferSize(window, &display_w, &display_h);
         glViewport(0, 0, display_w, display_h);
+        // En diferido la geometría va primero al G-buffer (del tamaño de la ventana)
+        bool deferred = renderPath == RENDER_DEFERRED;
+        if (deferred && (gbuffer.width() != display_w || gbuffer.height() != display_h)
+            && !gbuffer.create(display_w, display_h)) {
+            renderPath = RENDER_FORWARD;
+            deferred = false;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, deferred ? gbuffer.framebuffer() : 0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glUseProgram(shaderProgram);
-        // Enviar matrices de cámara y luz
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(lightSpaceMatrix));
-        // Enviar posición de la cámara (para el cálculo especular)
-        glm::vec3 camPos = glm::vec3(wasd_Movement.x, wasd_Movement.y, -18.0f + wasd_Movement.z);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(camPos));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "lightDir"), 1, glm::value_ptr(lightDir));
-        // Asignar las texturas: se utilizarán las unidades 0-2 para el objeto y la 3 para el mapa de sombras.
-        glUniform1i(glGetUniformLocation(shaderProgram, "diffuseTexture"), 0);
-        glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-        glUniform1i(glGetUniformLocation(shaderProgram, "texture2"), 1);
-        glUniform1i(glGetUniformLocation(shaderProgram, "texture3"), 2);
-        glUniform1i(glGetUniformLocation(shaderProgram, "shadowMap"), 3);
-
-        // Renderizar cada objeto del móvil
-        glBindVertexArray(cubeVAO);
-        for (int i = 0; i < 12; i++) {
-            glm::mat4 model = glm::mat4(1.0f);
-            if (i >= 5 && i < 9)
-                model = scale(glm::vec3(0.1f, 2.0f, 0.1f));
-            else if (i == 9)
-                model = scale(glm::vec3(4.0f, 0.1f, 0.1f));
-            else if (i == 10)
-                model = scale(glm::vec3(0.1f, 0.1f, 4.0f));
-            else if (i == 11)
-                model = scale(glm::vec3(0.1f, 4.0f, 0.1f));
-            model = glm::translate(model, posiciones[i]);
-            model = glm::rotate(glm::mat4(1.0f), angle, glm::vec3(0.0f, 1.0f, 0.0f)) * model;
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-            // Configurar uso de texturas y multitextura según el objeto
-            glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), useTextures[i]);
-            glUniform1i(glGetUniformLocation(shaderProgram, "useMultiTexture"), multiTexConfigs[i].useMultiTexture);
-            if (multiTexConfigs[i].useMultiTexture && useTextures[i]) {
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio1"), multiTexConfigs[i].mixRatio1);
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio2"), multiTexConfigs[i].mixRatio2);
-                glUniform1f(glGetUniformLocation(shaderProgram, "mixRatio3"), multiTexConfigs[i].mixRatio3);
-                // Vincular texturas para multitextura (unidades 0,1,2)
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex1]);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex2]);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, textures[multiTexConfigs[i].texIndex3]);
+        litPassTimer.begin();
+        if (vertexStageOnly)
+            glEnable(GL_RASTERIZER_DISCARD);
+        // Cubos visibles (instanciados o uno por uno) y el piso con los
+        // uniforms de superficie del programa activo
+        auto drawSurfaces = [&](SurfaceUniforms& surface) {
+            if (streamFull)
+                return;
+            glBindVertexArray(sceneVAO);
+            // Sin instancias probadas el buffer compacto puede no tener
+            // memoria: los atributos siguen apuntando al anillo
+            bool culledInstances = occlusionActive && !cameraObjects.empty();
+            glBindBuffer(GL_ARRAY_BUFFER, culledInstances ? hizCulling.visibleBuffer() : frameStream.id());
+            setInstanceAttributes(culledInstances ? 0 : cameraInstanceOffset);
+            // Multi-draw: cubos y piso en una sola llamada (con oclusión, los
+            // cubos usan el comando del compute shader y el piso va aparte)
+            if (multiDrawActive && !occlusionActive) {
+                surface.useInstancing.set(true);
+                drawCommands(cameraCommandOffset);
+                drawCalls++;
+                surface.useInstancing.set(false);
+                return;
+            }
+            if (useInstancing) {
+                surface.useInstancing.set(true);
+                if (occlusionActive) {
+                    // La cantidad de instancias la escribió el compute shader
+                    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, hizCulling.commandBuffer());
+                    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, 0);
+                    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+                    drawCalls++;
+                }
+                else if (!cameraObjects.empty()) {
+                    drawMeshRange(cubeRange, (GLsizei)cameraObjects.size());
+                    drawCalls++;
+                }
             }
             else {
-                // Uso de una sola textura (diffuseTexture)
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, textures[cubeTextures[i]]);
+                for (int obj : cameraObjects) {
+                    surface.model.set(instances[obj].model);
+                    surface.normalMatrix.set(glm::mat3(glm::vec3(instances[obj].normalMatrix[0]),
+                        glm::vec3(instances[obj].normalMatrix[1]), glm::vec3(instances[obj].normalMatrix[2])));
+                    // El material del objeto se lee del bloque Materials
+                    surface.materialIndex.set(instances[obj].materialIndex);
+                    drawMeshRange(cubeRange);
+                    drawCalls++;
+                }
             }
-            glActiveTexture(GL_TEXTURE3);
-            glBindTexture(GL_TEXTURE_2D, depthMap);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-
-        // Renderizar el piso
-        glBindVertexArray(planeVAO);
-        glm::mat4 modelFloorScene = glm::mat4(1.0f);  // Renombrada para evitar redefinición
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(modelFloorScene));
-        glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), true);
-        glUniform1i(glGetUniformLocation(shaderProgram, "useMultiTexture"), false);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[3]);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+            surface.useInstancing.set(false);
+
+            // Renderizar el piso
+            glm::mat4 modelFloorScene = glm::mat4(1.0f);  // Renombrada para evitar redefinición
+            surface.model.set(modelFloorScene);
+            surface.normalMatrix.set(glm::mat3(1.0f));
+            surface.materialIndex.set(FLOOR_MATERIAL);
+            drawMeshRange(planeRange);
+            drawCalls++;
+        };
+
+        // Pre-pasada: solo profundidad; después la pasada con color no
+        // escribe profundidad y solo acepta la superficie ya guardada
+        if (depthPrepass) {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            prepassProgram.use();
+            prepassSamples.begin();
+            drawSurfaces(prepassSurface);
+            prepassSamples.end();
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthFunc(prepassDepthTest == 0 ? GL_EQUAL : GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        ShaderProgram& surfaceProgram = deferred ? gbufferProgram : shaderProgram;
+        SurfaceUniforms& surface = deferred ? gbufferSurface : litSurface;
+        surfaceProgram.use();
+        surface.cpuNormalMatrix.set(cpuNormalMatrices);
+        // Todas las texturas de material en un solo arreglo (unidad 0)
+        materialArray.bind(0);
+        // Luces y sombras: en forward las lee el mismo programa; en diferido,
+        // la pasada de iluminación (las unidades 5-10 no las toca el G-buffer)
+        shadowMaps.bind(5, 6);
+        if (momentFilter)
+            shadowMoments.bind(7);
+        lightClusters.bind(8);
+        auto setLighting = [&](LightingUniforms& lighting) {
+            lighting.lightBleedReduction.set(lightBleedReduction);
+            lighting.pointLightCount.set(pointLightCount);
+            lighting.clusterScale.set(glm::vec4(CLUSTER_X / (float)display_w, CLUSTER_Y / (float)display_h,
+                lightClusters.depthScale(), lightClusters.depthBias()));
+            lighting.showCascades.set(showCascades);
+            lighting.shadowFilter.set(shadowFilter);
+            lighting.pcfRadius.set(pcfRadius);
+            lighting.poissonRadius.set(poissonRadius);
+        };
+        if (!deferred)
+            setLighting(litLighting);
+
+        litSamples.begin();
+        drawSurfaces(surface);
+        litSamples.end();
+        if (depthPrepass) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+
+        // Iluminación diferida: un triángulo de pantalla completa que ilumina
+        // cada píxel visible una sola vez. La profundidad de la ventana queda
+        // borrada: después solo se dibuja la interfaz.
+        if (deferred) {
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glDisable(GL_DEPTH_TEST);
+            deferredProgram.use();
+            setLighting(deferredLighting);
+            deferredInverseViewProjection.set(glm::inverse(projection * view));
+            gbuffer.bindTextures(0);
+            glBindVertexArray(fullscreenVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            drawCalls++;
+            glEnable(GL_DEPTH_TEST);
+        }
+        if (vertexStageOnly)
+            glDisable(GL_RASTERIZER_DISCARD);
+        litPassTimer.end();
+        // Pirámide para el culling del próximo frame (en diferido la
+        // profundidad de la ventana está vacía: se lee la del G-buffer)
+        if (occlusionActive)
+            hizCulling.capture(deferred ? gbuffer.framebuffer() : 0, display_w, display_h, projection * view);
+        // Los comandos que leen el slice actual ya están encolados
+        frameStream.endFrame();
+        if (streamFull) {
+            std::cout << "Error al reservar en el buffer de streaming: se agranda a "
+                << 2 * streamSliceSize << " bytes por slice" << std::endl;
+            streamSliceSize *= 2;
+            frameStream.create(streamSliceSize, streamSlices);
+        }
 
         // --- INTERFAZ IMGUI ---
         ImGui_ImplOpenGL3_NewFrame();
@@ -595,8 +2211,147 @@ int main() {
             }
             ImGui::SliderFloat("Mouse Sensitivity", &mouseSensitivity, 0.1f, 2.0f);
             ImGui::Separator();
+            ImGui::Text("Rendering:");
+            ImGui::Combo("Renderer", &renderPath, "Forward\0" "Deferred (G-buffer)\0");
+            ImGui::Checkbox("Depth pre-pass", &depthPrepass);
+            if (depthPrepass)
+                ImGui::Combo("Pre-pass depth test", &prepassDepthTest, "GL_EQUAL\0" "GL_LEQUAL\0");
+            ImGui::Checkbox("Sort front to back", &sortFrontToBack);
+            // Overdraw: muestras que pasaron la prueba de profundidad por píxel
+            double windowPixels = std::max(display_w * display_h, 1);
+            ImGui::Text("Overdraw: %.2f shaded samples/pixel, pre-pass %.2f, sort %.3f ms",
+                litSamples.samples() / windowPixels, depthPrepass ? prepassSamples.samples() / windowPixels : 0.0, sortMs);
+            ImGui::Checkbox("Instanced rendering", &useInstancing);
+            if (multiDrawSupported && useInstancing)
+                ImGui::Checkbox("Multi-draw indirect", &multiDraw);
+            ImGui::Checkbox("CPU normal matrices", &cpuNormalMatrices);
+            ImGui::SliderInt("Mobiles", &mobileCount, 1, MAX_MOBILES);
+            ImGui::SliderInt("Nesting levels", &nestingLevels, 1, 16);
+            ImGui::Checkbox("Animate mobiles", &animateMobiles);
+            ImGui::Text("Scene graph: %d nodes, %d updated", scene.size(), updatedNodes);
+            ImGui::Combo("Frustum culling", &cullingMode, "Off\0Flat (SIMD)\0BVH\0");
+            ImGui::Text("Camera: %d visible, %d culled", (int)cameraObjects.size(), objectCount - (int)cameraObjects.size());
+            ImGui::Text("Light: %d visible, %d culled", lightVisibleCount, objectCount - lightVisibleCount);
+            ImGui::Text("Culling: %.3f ms on %d threads", cullingMs, workers.threads() + 1);
+            if (occlusionSupported) {
+                ImGui::Checkbox("Occlusion culling (Hi-Z)", &occlusionCulling);
+                const OcclusionStats& occlusionStats = hizCulling.stats();
+                if (occlusionCulling && !useInstancing)
+                    ImGui::Text("Occlusion culling needs instanced rendering");
+                else if (occlusionCulling && occlusionStats.tested > 0)
+                    ImGui::Text("Occlusion: %d/%d culled (%.1f%%), GPU %.3f ms pyramid + %.3f ms test",
+                        occlusionStats.tested - occlusionStats.visible, occlusionStats.tested,
+                        100.0f * (occlusionStats.tested - occlusionStats.visible) / occlusionStats.tested,
+                        occlusionStats.buildMs, occlusionStats.cullMs);
+            }
+            else {
+                ImGui::Text("Occlusion culling: requires OpenGL 4.3");
+            }
+            if (!bvh.empty()) {
+                ImGui::Text("BVH: %d nodes, depth %d, update %.3f ms, %d rebuilds", bvh.nodeCount(), bvh.depth(), bvhUpdateMs, bvhRebuilds);
+                ImGui::Text("BVH refit quality: SAH x%.2f, worst node x%.2f", bvh.quality().sahRatio, bvh.quality().worstInflation);
+            }
+            if (pickedObject >= 0 && pickedObject < objectCount)
+                ImGui::Text("Picked: object %d (piece %d) at %.2f", pickedObject, instances[pickedObject].materialIndex, pickedDistance);
+            else
+                ImGui::Text("Picked: none (left click on a cube)");
+            ImGui::Text("%d cubes, %d draw calls, %.2f ms/frame", objectCount, drawCalls, 1000.0f / io.Framerate);
+            ImGui::Text("GPU: shadow pass %.2f ms, lit pass %.2f ms", depthPassTimer.milliseconds(), litPassTimer.milliseconds());
+            if (cpuNormalMatrices)
+                ImGui::Text("CPU normal matrices: %.3f ms", normalMatrixMs);
+            ImGui::Text("Uniform uploads: %u sent, %u skipped",
+                shaderProgram.stats().uploads + gbufferProgram.stats().uploads + deferredProgram.stats().uploads
+                    + depthShaderProgram.stats().uploads + prepassProgram.stats().uploads,
+                shaderProgram.stats().skipped + gbufferProgram.stats().skipped + deferredProgram.stats().skipped
+                    + depthShaderProgram.stats().skipped + prepassProgram.stats().skipped);
+            // Tamaño del anillo: si hay bloqueos frecuentes conviene más slices
+            const StreamBufferStats& streamStats = frameStream.stats();
+            if (ImGui::SliderInt("Ring slices", &streamSlices, 1, 8))
+                frameStream.create(streamSliceSize, streamSlices);
+            ImGui::Text("Ring: %s, %.1f/%.1f MB per slice", frameStream.persistent() ? "persistent" : "glBufferSubData",
+                frameStream.usedBytes() / (1024.0f * 1024.0f), frameStream.sliceBytes() / (1024.0f * 1024.0f));
+            ImGui::Text("Ring stalls: %u/%u frames, wait %.3f ms (max %.3f ms)", streamStats.stalls, streamStats.frames,
+                streamStats.lastWaitMs, streamStats.maxWaitMs);
+            if (ImGui::Button("Reset ring stats"))
+                frameStream.resetStats();
+            ImGui::Separator();
+            ImGui::Text("Shadows:");
+            ImGui::SliderInt("Cascades", &cascadeCount, 1, MAX_CASCADES);
+            ImGui::Combo("Shadow resolution", &shadowResolutionIndex, "512\0" "1024\0" "2048\0" "4096\0");
+            ImGui::SliderFloat("Shadow distance", &shadowDistance, 10.0f, 100.0f);
+            ImGui::SliderFloat("Split lambda", &cascadeSplitLambda, 0.0f, 1.0f);
+            ImGui::Combo("Shadow filter", &shadowFilter, "Hard\0" "Hardware 2x2\0" "PCF\0" "Poisson\0" "VSM\0" "EVSM\0");
+            if (shadowFilter == SHADOW_FILTER_PCF)
+                ImGui::SliderInt("PCF radius", &pcfRadius, 1, 3);
+            if (shadowFilter == SHADOW_FILTER_POISSON)
+                ImGui::SliderFloat("Poisson radius", &poissonRadius, 0.5f, 6.0f);
+            if (shadowFilter == SHADOW_FILTER_VSM || shadowFilter == SHADOW_FILTER_EVSM) {
+                ImGui::Combo("Moment resolution", &momentDownsampleIndex, "Full\0" "1/2\0" "1/4\0");
+                ImGui::SliderInt("Blur radius", &momentBlurRadius, 0, MAX_MOMENT_BLUR_RADIUS);
+                ImGui::SliderFloat("Light bleed reduction", &lightBleedReduction, 0.0f, 0.9f);
+                ImGui::Text("Moments GPU: %.3f ms", momentPassTimer.milliseconds());
+            }
+            ImGui::Checkbox("Snap to texels", &snapCascades);
+            ImGui::Checkbox("Show cascades", &showCascades);
+            ImGui::Checkbox("Shadow cache", &shadowCaching);
+            const ShadowCacheStats& cacheStats = shadowCache.stats();
+            ImGui::Text("Cascades: %u rendered, %u cached", cacheStats.renderedCascades, cacheStats.skippedCascades);
+            ImGui::Text("Shadow passes skipped: %u", cacheStats.skippedPasses);
+            if (ImGui::Button("Reset shadow stats"))
+                shadowCache.resetStats();
+            ImGui::Text("Splits: %.1f %.1f %.1f %.1f", cascades.splitFar[0],
+                cascades.count > 1 ? cascades.splitFar[1] : 0.0f, cascades.count > 2 ? cascades.splitFar[2] : 0.0f,
+                cascades.count > 3 ? cascades.splitFar[3] : 0.0f);
+            ImGui::Text("Texel size: %.3f %.3f %.3f %.3f", cascades.texelSize[0],
+                cascades.count > 1 ? cascades.texelSize[1] : 0.0f, cascades.count > 2 ? cascades.texelSize[2] : 0.0f,
+                cascades.count > 3 ? cascades.texelSize[3] : 0.0f);
+            ImGui::Separator();
+            ImGui::Text("Point lights (%s):", lightClusters.storageBuffers() ? "SSBO" : "texture buffers");
+            ImGui::SliderInt("Lights", &pointLightCount, 0, 4096, "%d", ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderFloat("Light radius", &pointLightRadius, 1.0f, 15.0f);
+            ImGui::Checkbox("Animate lights", &animateLights);
+            if (pointLightCount > 0) {
+                const LightClusterStats& clusterStats = lightClusters.stats();
+                ImGui::Text("Clusters %dx%dx%d: %d occupied, max %d lights", CLUSTER_X, CLUSTER_Y, CLUSTER_Z,
+                    clusterStats.occupiedClusters, clusterStats.maxPerCluster);
+                ImGui::Text("Light indices: %d, assign %.3f ms", clusterStats.indices, clusterStats.assignMs);
+                if (clusterStats.droppedIndices > 0)
+                    ImGui::Text("Dropped indices: %d (texture buffer limit)", clusterStats.droppedIndices);
+            }
+            ImGui::Separator();
             ImGui::Text("Texture Settings:");
-            const char* textureNames[] = { "Wood", "Metal", "Concrete", "Grass", "Stone" };
+            const TextureLoaderStats& loaderStats = textureLoader.stats();
+            ImGui::SliderInt("Upload budget (MB/frame)", &textureUploadMB, 1, 64);
+            ImGui::Text("Textures: %d/%d ready (%d cooked), %d decoding, %d queued, %d failed", loaderStats.ready,
+                loaderStats.requested, loaderStats.cooked, loaderStats.decoding, loaderStats.queued, loaderStats.failed);
+            ImGui::Text("Uploaded %.2f MB this frame, %.1f MB total; first frame at %.0f ms",
+                loaderStats.frameBytes / (1024.0 * 1024.0), loaderStats.totalBytes / (1024.0 * 1024.0), firstFrameMs);
+            const TextureCacheStats& textureStats = textureCache.stats();
+            int textureLookups = textureStats.hits + textureStats.misses;
+            ImGui::SliderInt("Cache budget (MB)", &textureCacheMB, 1, 512);
+            ImGui::Text("Cache: %d resident, %.1f/%.0f MB, %d evicted", textureStats.resident,
+                textureStats.residentBytes / (1024.0 * 1024.0), textureStats.budget / (1024.0 * 1024.0), textureStats.evictions);
+            ImGui::Text("Cache hits: %d/%d (%.0f%%), %d shared by content", textureStats.hits, textureLookups,
+                textureLookups > 0 ? 100.0 * textureStats.hits / textureLookups : 0.0, textureStats.shared);
+            const char* layerSizeNames[] = { "256", "512", "1024", "2048" };
+            if (ImGui::Combo("Material layer size", &materialLayerSizeIndex, layerSizeNames, IM_ARRAYSIZE(layerSizeNames)))
+                materialArray.create(materialLayerSizes[materialLayerSizeIndex], (int)textures.size());
+            ImGui::Text("Material array: %d layers of %dx%d, %d layer copies", materialArray.layers(),
+                materialArray.layerSize(), materialArray.layerSize(), materialArray.copies());
+            // Cambiar el archivo de una ranura suelta la referencia anterior:
+            // la textura queda en caché hasta que haga falta el espacio
+            const char* textureNames[5];
+            for (int slot = 0; slot < 5; slot++) {
+                ImGui::PushID(slot + 200);
+                char slotLabel[32];
+                snprintf(slotLabel, sizeof(slotLabel), "Slot %d", slot);
+                if (ImGui::Combo(slotLabel, &paletteFiles[slot], textureFileNames, IM_ARRAYSIZE(textureFileNames))) {
+                    textureCache.release(textures[slot]);
+                    textures[slot] = textureCache.acquire(textureFiles[paletteFiles[slot]]);
+                }
+                textureNames[slot] = textureFileNames[paletteFiles[slot]];
+                ImGui::PopID();
+            }
             for (int i = 0; i < 5; i++) {
                 ImGui::PushID(i);
                 ImGui::Checkbox("Use Texture", &useTextures[i]);
@@ -645,22 +2400,57 @@ int main() {
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+        if (benchmark.measuring()) {
+            benchmark.record("frame (ms)", deltaTime * 1000.0);
+            benchmark.record("sombras GPU (ms)", depthPassTimer.milliseconds());
+            benchmark.record("momentos GPU (ms)", momentPassTimer.milliseconds());
+            benchmark.record("pasada 2 GPU (ms)", litPassTimer.milliseconds());
+            benchmark.record("normales CPU (ms)", cpuNormalMatrices ? normalMatrixMs : 0.0);
+            benchmark.record("luces CPU (ms)", pointLightCount > 0 ? lightClusters.stats().assignMs : 0.0);
+            if (occlusionActive && hizCulling.stats().tested > 0) {
+                const OcclusionStats& occlusionStats = hizCulling.stats();
+                benchmark.record("ocultos (%)", 100.0 * (occlusionStats.tested - occlusionStats.visible) / occlusionStats.tested);
+                benchmark.record("oclusión GPU (ms)", occlusionStats.buildMs + occlusionStats.cullMs);
+            }
+            benchmark.record("muestras por píxel", litSamples.samples() / (double)std::max(display_w * display_h, 1));
+        }
+        benchmark.endFrame();
+        if (!benchName.empty() && !benchmark.active())
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+
         glfwSwapBuffers(window);
         glfwPollEvents();
+        // glfwGetTime cuenta desde glfwInit
+        if (firstFrameMs < 0.0) {
+            firstFrameMs = glfwGetTime() * 1000.0;
+            std::cout << "Primer frame a los " << firstFrameMs << " ms" << std::endl;
+        }
     }
 
     // Limpieza de recursos
-    glDeleteVertexArrays(1, &cubeVAO);
-    glDeleteBuffers(1, &cubeVBO);
-    glDeleteVertexArrays(1, &planeVAO);
-    glDeleteBuffers(1, &planeVBO);
-    glDeleteProgram(shaderProgram);
-    glDeleteProgram(depthShaderProgram);
-    for (unsigned int tex : textures) {
-        glDeleteTextures(1, &tex);
-    }
-    glDeleteTextures(1, &depthMap);
-    glDeleteFramebuffers(1, &depthMapFBO);
+    workers.destroy();
+    sceneMesh.destroy();
+    frameStream.destroy();
+    depthPassTimer.destroy();
+    momentPassTimer.destroy();
+    litPassTimer.destroy();
+    prepassSamples.destroy();
+    hizCulling.destroy();
+    litSamples.destroy();
+    materialUBO.destroy();
+    shaderProgram.destroy();
+    gbufferProgram.destroy();
+    deferredProgram.destroy();
+    prepassProgram.destroy();
+    gbuffer.destroy();
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    depthShaderProgram.destroy();
+    materialArray.destroy();
+    textureCache.destroy();
+    textureLoader.destroy();
+    shadowMaps.destroy();
+    shadowMoments.destroy();
+    lightClusters.destroy();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,94 @@
+#include "mapped_file.hpp"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace myopengl {
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+		HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (handle == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(handle);
+			return false;
+		}
+		HANDLE view = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!view) {
+			CloseHandle(handle);
+			return false;
+		}
+		bytes = (const unsigned char*)MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0);
+		if (!bytes) {
+			CloseHandle(view);
+			CloseHandle(handle);
+			return false;
+		}
+		file = handle;
+		mapping = view;
+		length = (size_t)fileSize.QuadPart;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (bytes)
+			UnmapViewOfFile(bytes);
+		if (mapping)
+			CloseHandle((HANDLE)mapping);
+		if (file)
+			CloseHandle((HANDLE)file);
+		bytes = nullptr;
+		mapping = nullptr;
+		file = nullptr;
+		length = 0;
+	}
+#else
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+		int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+		struct stat info;
+		if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+			::close(descriptor);
+			return false;
+		}
+		void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		// La proyección sigue válida después de cerrar el descriptor
+		::close(descriptor);
+		if (view == MAP_FAILED)
+			return false;
+		bytes = (const unsigned char*)view;
+		length = (size_t)info.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (bytes)
+			munmap((void*)bytes, length);
+		bytes = nullptr;
+		length = 0;
+	}
+#endif
+
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace myopengl {
+
+	// Archivo de solo lectura proyectado en memoria: el sistema trae las
+	// páginas a medida que se leen, sin copiarlas a un buffer propio.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// false si no existe, está vacío o no se pudo proyectar
+		bool open(const std::string& path);
+		void close();
+
+		const unsigned char* data() const { return bytes; }
+		size_t size() const { return length; }
+		bool isOpen() const { return bytes != nullptr; }
+
+	private:
+		const unsigned char* bytes = nullptr;
+		size_t length = 0;
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#endif
+	};
+
+}
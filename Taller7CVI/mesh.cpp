@@ -0,0 +1,118 @@
+#include "mesh.hpp"
+#include <glm/gtc/packing.hpp>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+namespace myopengl {
+
+	MeshData buildIndexedMesh(const float* interleaved, size_t vertexCount)
+	{
+		MeshData mesh;
+		// Se sueldan los vértices con exactamente los mismos atributos de
+		// origen; el orden de primera aparición conserva la localidad para
+		// la caché post-transformación.
+		typedef std::tuple<float, float, float, float, float, float, float, float> VertexKey;
+		std::map<VertexKey, uint16_t> welded;
+		mesh.indices.reserve(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++) {
+			const float* v = interleaved + i * 8;
+			VertexKey key(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+			auto found = welded.find(key);
+			if (found != welded.end()) {
+				mesh.indices.push_back(found->second);
+				continue;
+			}
+			// Los índices son de 16 bits: un vértice más no tendría índice
+			if (mesh.vertices.size() > 0xFFFF) {
+				std::cout << "Error al construir la malla: más de 65536 vértices únicos" << std::endl;
+				return MeshData();
+			}
+			PackedVertex packed;
+			packed.position[0] = v[0];
+			packed.position[1] = v[1];
+			packed.position[2] = v[2];
+			packed.normal = glm::packSnorm3x10_1x2(glm::vec4(glm::normalize(glm::vec3(v[3], v[4], v[5])), 0.0f));
+			packed.texCoord[0] = glm::packHalf1x16(v[6]);
+			packed.texCoord[1] = glm::packHalf1x16(v[7]);
+			uint16_t index = (uint16_t)mesh.vertices.size();
+			mesh.vertices.push_back(packed);
+			welded[key] = index;
+			mesh.indices.push_back(index);
+		}
+		return mesh;
+	}
+
+	Mesh uploadMeshes(const std::vector<MeshView>& meshes, std::vector<MeshRange>& ranges)
+	{
+		Mesh mesh;
+		ranges.clear();
+		for (const MeshView& view : meshes) {
+			MeshRange range;
+			range.indexCount = (GLsizei)view.indexCount;
+			range.firstIndex = (GLuint)mesh.indexCount;
+			range.baseVertex = (GLint)mesh.vertexCount;
+			ranges.push_back(range);
+			mesh.indexCount += (GLsizei)view.indexCount;
+			mesh.vertexCount += (GLsizei)view.vertexCount;
+		}
+		glGenVertexArrays(1, &mesh.vao);
+		glGenBuffers(1, &mesh.vbo);
+		glGenBuffers(1, &mesh.ebo);
+		glBindVertexArray(mesh.vao);
+		// Cada malla se copia a su lugar desde donde esté, sin juntarlas antes
+		glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+		glBufferData(GL_ARRAY_BUFFER, mesh.vertexCount * sizeof(PackedVertex), NULL, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indexCount * sizeof(uint16_t), NULL, GL_STATIC_DRAW);
+		for (size_t i = 0; i < meshes.size(); i++) {
+			glBufferSubData(GL_ARRAY_BUFFER, ranges[i].baseVertex * sizeof(PackedVertex),
+				meshes[i].vertexCount * sizeof(PackedVertex), meshes[i].vertices);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, ranges[i].firstIndex * sizeof(uint16_t),
+				meshes[i].indexCount * sizeof(uint16_t), meshes[i].indices);
+		}
+		// Atributo 0: posición
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		glEnableVertexAttribArray(0);
+		// Atributo 1: normal empaquetada (normalizada a [-1, 1])
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		glEnableVertexAttribArray(1);
+		// Atributo 2: coord. de textura en half float
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoord));
+		glEnableVertexAttribArray(2);
+		glBindVertexArray(0);
+		return mesh;
+	}
+
+	DrawElementsIndirectCommand MeshRange::command(GLuint instanceCount, GLuint baseInstance) const
+	{
+		DrawElementsIndirectCommand result = { (GLuint)indexCount, instanceCount, firstIndex, baseVertex, baseInstance };
+		return result;
+	}
+
+	void drawMeshRange(const MeshRange& range)
+	{
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT,
+			(void*)(range.firstIndex * sizeof(uint16_t)), range.baseVertex);
+	}
+
+	void drawMeshRange(const MeshRange& range, GLsizei instanceCount)
+	{
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_SHORT,
+			(void*)(range.firstIndex * sizeof(uint16_t)), instanceCount, range.baseVertex);
+	}
+
+	void Mesh::destroy()
+	{
+		if (vao)
+			glDeleteVertexArrays(1, &vao);
+		if (vbo)
+			glDeleteBuffers(1, &vbo);
+		if (ebo)
+			glDeleteBuffers(1, &ebo);
+		vao = vbo = ebo = 0;
+	}
+
+}
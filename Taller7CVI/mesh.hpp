@@ -0,0 +1,80 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	// Vértice compacto (20 bytes frente a los 32 del formato original):
+	// posición en float, normal en GL_INT_2_10_10_10_REV y UV en half float
+	struct PackedVertex {
+		float position[3];
+		uint32_t normal;
+		uint16_t texCoord[2];
+	};
+
+	// Malla indexada lista para subir a la GPU
+	struct MeshData {
+		std::vector<PackedVertex> vertices;
+		std::vector<uint16_t> indices;
+	};
+
+	// Malla en memoria ajena (p. ej. un paquete proyectado): se sube sin copiarla
+	struct MeshView {
+		const PackedVertex* vertices = nullptr;
+		size_t vertexCount = 0;
+		const uint16_t* indices = nullptr;
+		size_t indexCount = 0;
+
+		MeshView() = default;
+		MeshView(const MeshData& data)
+			: vertices(data.vertices.data()), vertexCount(data.vertices.size()),
+			indices(data.indices.data()), indexCount(data.indices.size()) {}
+	};
+
+	// Construye una malla indexada a partir de vértices intercalados
+	// (posición, normal, UV = 8 floats), soldando los vértices repetidos.
+	// Los índices son de 16 bits: con más de 65536 vértices únicos imprime
+	// el error y devuelve una malla vacía.
+	MeshData buildIndexedMesh(const float* interleaved, size_t vertexCount);
+
+	// Buffers de GL de una malla. Los atributos 0-2 quedan configurados en el VAO.
+	struct Mesh {
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		GLuint ebo = 0;
+		GLsizei indexCount = 0;
+		GLsizei vertexCount = 0;
+
+		void destroy();
+	};
+
+	// Comando de glDrawElementsIndirect / glMultiDrawElementsIndirect
+	struct DrawElementsIndirectCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// Una malla dentro de buffers compartidos: sus índices empiezan en
+	// firstIndex y se suman a baseVertex (así siguen siendo de 16 bits)
+	struct MeshRange {
+		GLsizei indexCount = 0;
+		GLuint firstIndex = 0;
+		GLint baseVertex = 0;
+
+		DrawElementsIndirectCommand command(GLuint instanceCount, GLuint baseInstance) const;
+	};
+
+	// Sube varias mallas a un solo VBO/IBO con un único VAO; ranges recibe
+	// el rango de cada una, en el mismo orden
+	Mesh uploadMeshes(const std::vector<MeshView>& meshes, std::vector<MeshRange>& ranges);
+
+	// Dibuja un rango del VAO activo, sin instancing o con instanceCount instancias
+	void drawMeshRange(const MeshRange& range);
+	void drawMeshRange(const MeshRange& range, GLsizei instanceCount);
+
+}
@@ -1,14 +1,289 @@
 #include "myopengl.hpp"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MYOPENGL_SSE 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC y Clang solo generan AVX2 en las funciones marcadas; MSVC lo acepta siempre
+#if defined(__GNUC__)
+#define MYOPENGL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MYOPENGL_TARGET_AVX2
+#endif
+
 namespace myopengl {
 
-	glm::mat4 myopengl::scale(const glm::vec3& scaleVector)
+	glm::mat4 scale(const glm::vec3& scaleVector)
 	{
 		glm::mat4 model = glm::mat4(1.0f);
 		return glm::scale(model, scaleVector);
 	}
 
+	// --- Detección de la CPU ---
+
+#ifdef MYOPENGL_SSE
+	static void cpuid(int leaf, int subleaf, int regs[4])
+	{
+#if defined(_MSC_VER)
+		__cpuidex(regs, leaf, subleaf);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(leaf, subleaf, a, b, c, d);
+		regs[0] = (int)a;
+		regs[1] = (int)b;
+		regs[2] = (int)c;
+		regs[3] = (int)d;
+#endif
+	}
+
+	// Registro XCR0: indica si el sistema operativo guarda los registros YMM
+	static unsigned long long xgetbv0()
+	{
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__ volatile(".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((unsigned long long)hi << 32) | lo;
+#endif
+	}
+#endif
+
+	static SimdLevel querySimdLevel()
+	{
+#ifdef MYOPENGL_SSE
+		int regs[4];
+		cpuid(0, 0, regs);
+		int maxLeaf = regs[0];
+		cpuid(1, 0, regs);
+		bool osxsave = (regs[2] & (1 << 27)) != 0;
+		bool avx = (regs[2] & (1 << 28)) != 0;
+		if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 0x6) == 0x6) {
+			cpuid(7, 0, regs);
+			if (regs[1] & (1 << 5))
+				return SIMD_AVX2;
+		}
+		return SIMD_SSE;
+#else
+		return SIMD_SCALAR;
+#endif
+	}
+
+	SimdLevel detectSimdLevel()
+	{
+		static const SimdLevel level = querySimdLevel();
+		return level;
+	}
+
+	const char* simdLevelName(SimdLevel level)
+	{
+		switch (level) {
+		case SIMD_AVX2: return "AVX2";
+		case SIMD_SSE: return "SSE";
+		default: return "escalar";
+		}
+	}
+
+	// --- TransformArray ---
+
+	size_t TransformArray::add(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		size_t index = size();
+		tx.push_back(translation.x);
+		ty.push_back(translation.y);
+		tz.push_back(translation.z);
+		qx.push_back(rotation.x);
+		qy.push_back(rotation.y);
+		qz.push_back(rotation.z);
+		qw.push_back(rotation.w);
+		sx.push_back(scale.x);
+		sy.push_back(scale.y);
+		sz.push_back(scale.z);
+		return index;
+	}
+
+	void TransformArray::clear()
+	{
+		for (std::vector<float>* component : { &tx, &ty, &tz, &qx, &qy, &qz, &qw, &sx, &sy, &sz })
+			component->clear();
+	}
+
+	void TransformArray::setTranslation(size_t index, const glm::vec3& translation)
+	{
+		tx[index] = translation.x;
+		ty[index] = translation.y;
+		tz[index] = translation.z;
+	}
+
+	void TransformArray::setRotation(size_t index, const glm::quat& rotation)
+	{
+		qx[index] = rotation.x;
+		qy[index] = rotation.y;
+		qz[index] = rotation.z;
+		qw[index] = rotation.w;
+	}
+
+	void TransformArray::setScale(size_t index, const glm::vec3& scale)
+	{
+		sx[index] = scale.x;
+		sy[index] = scale.y;
+		sz[index] = scale.z;
+	}
+
+	// --- Composición en lote ---
+	// Las columnas de T * R * S son R(q) escalada por eje y la traslación:
+	//   c0 = sx * (1 - 2(yy + zz), 2(xy + wz), 2(xz - wy))
+	//   c1 = sy * (2(xy - wz), 1 - 2(xx + zz), 2(yz + wx))
+	//   c2 = sz * (2(xz + wy), 2(yz - wx), 1 - 2(xx + yy))
+	//   c3 = (tx, ty, tz, 1)
+
+	static float* outColumn(glm::mat4* out, size_t stride, size_t index, int col)
+	{
+		return (float*)((char*)out + stride * index) + col * 4;
+	}
+
+	static void composeScalar(const TransformArray& t, size_t first, size_t end, glm::mat4* out, size_t stride)
+	{
+		for (size_t i = first; i < end; i++) {
+			float x = t.qx[i], y = t.qy[i], z = t.qz[i], w = t.qw[i];
+			float xx = 2.0f * x * x, yy = 2.0f * y * y, zz = 2.0f * z * z;
+			float xy = 2.0f * x * y, xz = 2.0f * x * z, yz = 2.0f * y * z;
+			float wx = 2.0f * w * x, wy = 2.0f * w * y, wz = 2.0f * w * z;
+			float* c0 = outColumn(out, stride, i - first, 0);
+			float* c1 = outColumn(out, stride, i - first, 1);
+			float* c2 = outColumn(out, stride, i - first, 2);
+			float* c3 = outColumn(out, stride, i - first, 3);
+			c0[0] = (1.0f - yy - zz) * t.sx[i]; c0[1] = (xy + wz) * t.sx[i]; c0[2] = (xz - wy) * t.sx[i]; c0[3] = 0.0f;
+			c1[0] = (xy - wz) * t.sy[i]; c1[1] = (1.0f - xx - zz) * t.sy[i]; c1[2] = (yz + wx) * t.sy[i]; c1[3] = 0.0f;
+			c2[0] = (xz + wy) * t.sz[i]; c2[1] = (yz - wx) * t.sz[i]; c2[2] = (1.0f - xx - yy) * t.sz[i]; c2[3] = 0.0f;
+			c3[0] = t.tx[i]; c3[1] = t.ty[i]; c3[2] = t.tz[i]; c3[3] = 1.0f;
+		}
+	}
+
+#ifdef MYOPENGL_SSE
+	// Transpone una columna de cuatro objetos (un registro por componente)
+	// y la escribe en cada matriz de salida
+	static void storeColumn4(glm::mat4* out, size_t stride, size_t base, int col,
+		__m128 x, __m128 y, __m128 z, __m128 w)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(outColumn(out, stride, base + 0, col), x);
+		_mm_storeu_ps(outColumn(out, stride, base + 1, col), y);
+		_mm_storeu_ps(outColumn(out, stride, base + 2, col), z);
+		_mm_storeu_ps(outColumn(out, stride, base + 3, col), w);
+	}
+
+	static size_t composeSSE(const TransformArray& t, size_t first, size_t end, glm::mat4* out, size_t stride)
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 zero = _mm_setzero_ps();
+		size_t i = first;
+		for (; i + 4 <= end; i += 4) {
+			__m128 x = _mm_loadu_ps(&t.qx[i]), y = _mm_loadu_ps(&t.qy[i]);
+			__m128 z = _mm_loadu_ps(&t.qz[i]), w = _mm_loadu_ps(&t.qw[i]);
+			__m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+			__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+			__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+			__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+			__m128 sx = _mm_loadu_ps(&t.sx[i]), sy = _mm_loadu_ps(&t.sy[i]), sz = _mm_loadu_ps(&t.sz[i]);
+			size_t base = i - first;
+			storeColumn4(out, stride, base, 0,
+				_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+				_mm_mul_ps(_mm_add_ps(xy, wz), sx),
+				_mm_mul_ps(_mm_sub_ps(xz, wy), sx), zero);
+			storeColumn4(out, stride, base, 1,
+				_mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+				_mm_mul_ps(_mm_add_ps(yz, wx), sy), zero);
+			storeColumn4(out, stride, base, 2,
+				_mm_mul_ps(_mm_add_ps(xz, wy), sz),
+				_mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), zero);
+			storeColumn4(out, stride, base, 3,
+				_mm_loadu_ps(&t.tx[i]), _mm_loadu_ps(&t.ty[i]), _mm_loadu_ps(&t.tz[i]), one);
+		}
+		return i;
+	}
+
+	// Igual que storeColumn4 para ocho objetos: cada mitad de 128 bits del
+	// resultado transpuesto es la columna de un objeto (k y k + 4)
+	MYOPENGL_TARGET_AVX2
+	static void storeColumn8(glm::mat4* out, size_t stride, size_t base, int col,
+		__m256 x, __m256 y, __m256 z, __m256 w)
+	{
+		__m256 xy0 = _mm256_unpacklo_ps(x, y), xy1 = _mm256_unpackhi_ps(x, y);
+		__m256 zw0 = _mm256_unpacklo_ps(z, w), zw1 = _mm256_unpackhi_ps(z, w);
+		__m256 c[4] = {
+			_mm256_shuffle_ps(xy0, zw0, 0x44),
+			_mm256_shuffle_ps(xy0, zw0, 0xEE),
+			_mm256_shuffle_ps(xy1, zw1, 0x44),
+			_mm256_shuffle_ps(xy1, zw1, 0xEE)
+		};
+		for (int k = 0; k < 4; k++) {
+			_mm_storeu_ps(outColumn(out, stride, base + k, col), _mm256_castps256_ps128(c[k]));
+			_mm_storeu_ps(outColumn(out, stride, base + k + 4, col), _mm256_extractf128_ps(c[k], 1));
+		}
+	}
 
+	MYOPENGL_TARGET_AVX2
+	static size_t composeAVX2(const TransformArray& t, size_t first, size_t end, glm::mat4* out, size_t stride)
+	{
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 zero = _mm256_setzero_ps();
+		size_t i = first;
+		for (; i + 8 <= end; i += 8) {
+			__m256 x = _mm256_loadu_ps(&t.qx[i]), y = _mm256_loadu_ps(&t.qy[i]);
+			__m256 z = _mm256_loadu_ps(&t.qz[i]), w = _mm256_loadu_ps(&t.qw[i]);
+			__m256 x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y), z2 = _mm256_add_ps(z, z);
+			__m256 xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2), zz = _mm256_mul_ps(z, z2);
+			__m256 xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2), yz = _mm256_mul_ps(y, z2);
+			__m256 wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2), wz = _mm256_mul_ps(w, z2);
+			__m256 sx = _mm256_loadu_ps(&t.sx[i]), sy = _mm256_loadu_ps(&t.sy[i]), sz = _mm256_loadu_ps(&t.sz[i]);
+			size_t base = i - first;
+			storeColumn8(out, stride, base, 0,
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx),
+				_mm256_mul_ps(_mm256_add_ps(xy, wz), sx),
+				_mm256_mul_ps(_mm256_sub_ps(xz, wy), sx), zero);
+			storeColumn8(out, stride, base, 1,
+				_mm256_mul_ps(_mm256_sub_ps(xy, wz), sy),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy),
+				_mm256_mul_ps(_mm256_add_ps(yz, wx), sy), zero);
+			storeColumn8(out, stride, base, 2,
+				_mm256_mul_ps(_mm256_add_ps(xz, wy), sz),
+				_mm256_mul_ps(_mm256_sub_ps(yz, wx), sz),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz), zero);
+			storeColumn8(out, stride, base, 3,
+				_mm256_loadu_ps(&t.tx[i]), _mm256_loadu_ps(&t.ty[i]), _mm256_loadu_ps(&t.tz[i]), one);
+		}
+		return i;
+	}
+#endif
 
+	void composeTransforms(const TransformArray& transforms, size_t first, size_t count,
+		glm::mat4* out, size_t outStride)
+	{
+		composeTransforms(transforms, first, count, out, outStride, detectSimdLevel());
+	}
+
+	void composeTransforms(const TransformArray& transforms, size_t first, size_t count,
+		glm::mat4* out, size_t outStride, SimdLevel level)
+	{
+		size_t end = first + count;
+		size_t i = first;
+#ifdef MYOPENGL_SSE
+		// El kernel ancho procesa bloques completos; el resto baja al siguiente nivel
+		if (level >= SIMD_AVX2 && detectSimdLevel() >= SIMD_AVX2)
+			i = composeAVX2(transforms, i, end, (glm::mat4*)((char*)out + outStride * (i - first)), outStride);
+		if (level >= SIMD_SSE)
+			i = composeSSE(transforms, i, end, (glm::mat4*)((char*)out + outStride * (i - first)), outStride);
+#endif
+		composeScalar(transforms, i, end, (glm::mat4*)((char*)out + outStride * (i - first)), outStride);
+	}
 
-}
\ No newline at end of file
+}
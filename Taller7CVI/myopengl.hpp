@@ -1,9 +1,53 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstddef>
+#include <vector>
 
 namespace myopengl {
 
 	glm::mat4 scale(const glm::vec3& scaleVector);
 
-}
\ No newline at end of file
+	// Conjunto de instrucciones usado por los kernels en lote
+	enum SimdLevel {
+		SIMD_SCALAR,
+		SIMD_SSE,
+		SIMD_AVX2
+	};
+
+	// Mejor nivel soportado por la CPU (se detecta una vez con cpuid)
+	SimdLevel detectSimdLevel();
+	const char* simdLevelName(SimdLevel level);
+
+	// Traslación, rotación y escala de muchos objetos en estructura de
+	// arreglos (SoA): cada componente vive en su propio arreglo contiguo,
+	// de modo que los kernels SIMD cargan 4 u 8 objetos por instrucción.
+	class TransformArray {
+	public:
+		size_t add(const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+		void clear();
+		size_t size() const { return tx.size(); }
+
+		void setTranslation(size_t index, const glm::vec3& translation);
+		void setRotation(size_t index, const glm::quat& rotation);
+		void setScale(size_t index, const glm::vec3& scale);
+
+		glm::vec3 translation(size_t index) const { return glm::vec3(tx[index], ty[index], tz[index]); }
+		glm::quat rotation(size_t index) const { return glm::quat(qw[index], qx[index], qy[index], qz[index]); }
+		glm::vec3 scale(size_t index) const { return glm::vec3(sx[index], sy[index], sz[index]); }
+
+		std::vector<float> tx, ty, tz;
+		std::vector<float> qx, qy, qz, qw;
+		std::vector<float> sx, sy, sz;
+	};
+
+	// Compone T * R * S de los objetos [first, first + count) y escribe cada
+	// matriz en out, avanzando outStride bytes por objeto. El kernel se elige
+	// según level (por defecto, el mejor que soporte la CPU).
+	void composeTransforms(const TransformArray& transforms, size_t first, size_t count,
+		glm::mat4* out, size_t outStride = sizeof(glm::mat4));
+	void composeTransforms(const TransformArray& transforms, size_t first, size_t count,
+		glm::mat4* out, size_t outStride, SimdLevel level);
+
+}
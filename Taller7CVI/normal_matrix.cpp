@@ -0,0 +1,94 @@
+#include "normal_matrix.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MYOPENGL_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace myopengl {
+
+	// inversa(M)^T = [c1 x c2, c2 x c0, c0 x c1] / det(M), con c0..c2 las columnas de M
+	void computeNormalMatrix(const glm::mat4& model, glm::vec4* normal)
+	{
+		glm::vec3 c0(model[0].x, model[0].y, model[0].z);
+		glm::vec3 c1(model[1].x, model[1].y, model[1].z);
+		glm::vec3 c2(model[2].x, model[2].y, model[2].z);
+		glm::vec3 n0 = glm::cross(c1, c2);
+		float invDet = 1.0f / glm::dot(c0, n0);
+		normal[0] = glm::vec4(n0 * invDet, 0.0f);
+		normal[1] = glm::vec4(glm::cross(c2, c0) * invDet, 0.0f);
+		normal[2] = glm::vec4(glm::cross(c0, c1) * invDet, 0.0f);
+	}
+
+	template <typename T>
+	static T* advance(T* base, size_t stride, size_t index)
+	{
+		return (T*)((const char*)base + stride * index);
+	}
+
+#ifdef MYOPENGL_SSE
+	// Carga la columna col de cuatro matrices y la transpone: x, y, z quedan
+	// en un registro cada uno (una matriz por carril)
+	static void loadColumn(const glm::mat4* models, size_t stride, size_t first, int col,
+		__m128& x, __m128& y, __m128& z)
+	{
+		__m128 a = _mm_loadu_ps(&(*advance(models, stride, first + 0))[col].x);
+		__m128 b = _mm_loadu_ps(&(*advance(models, stride, first + 1))[col].x);
+		__m128 c = _mm_loadu_ps(&(*advance(models, stride, first + 2))[col].x);
+		__m128 d = _mm_loadu_ps(&(*advance(models, stride, first + 3))[col].x);
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		x = a;
+		y = b;
+		z = c;
+	}
+
+	// Escribe la columna col de cuatro matrices normales (w = 0)
+	static void storeColumn(glm::vec4* normals, size_t stride, size_t first, int col,
+		__m128 x, __m128 y, __m128 z)
+	{
+		__m128 w = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&advance(normals, stride, first + 0)[col].x, x);
+		_mm_storeu_ps(&advance(normals, stride, first + 1)[col].x, y);
+		_mm_storeu_ps(&advance(normals, stride, first + 2)[col].x, z);
+		_mm_storeu_ps(&advance(normals, stride, first + 3)[col].x, w);
+	}
+
+	static void cross4(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz,
+		__m128& rx, __m128& ry, __m128& rz)
+	{
+		rx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+		ry = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+		rz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+	}
+#endif
+
+	void computeNormalMatrices(const glm::mat4* models, size_t modelStride,
+		glm::vec4* normals, size_t normalStride, size_t count)
+	{
+		size_t i = 0;
+#ifdef MYOPENGL_SSE
+		for (; i + 4 <= count; i += 4) {
+			__m128 c0x, c0y, c0z, c1x, c1y, c1z, c2x, c2y, c2z;
+			loadColumn(models, modelStride, i, 0, c0x, c0y, c0z);
+			loadColumn(models, modelStride, i, 1, c1x, c1y, c1z);
+			loadColumn(models, modelStride, i, 2, c2x, c2y, c2z);
+
+			__m128 n0x, n0y, n0z, n1x, n1y, n1z, n2x, n2y, n2z;
+			cross4(c1x, c1y, c1z, c2x, c2y, c2z, n0x, n0y, n0z);
+			cross4(c2x, c2y, c2z, c0x, c0y, c0z, n1x, n1y, n1z);
+			cross4(c0x, c0y, c0z, c1x, c1y, c1z, n2x, n2y, n2z);
+
+			__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0x, n0x), _mm_mul_ps(c0y, n0y)), _mm_mul_ps(c0z, n0z));
+			__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+			storeColumn(normals, normalStride, i, 0, _mm_mul_ps(n0x, invDet), _mm_mul_ps(n0y, invDet), _mm_mul_ps(n0z, invDet));
+			storeColumn(normals, normalStride, i, 1, _mm_mul_ps(n1x, invDet), _mm_mul_ps(n1y, invDet), _mm_mul_ps(n1z, invDet));
+			storeColumn(normals, normalStride, i, 2, _mm_mul_ps(n2x, invDet), _mm_mul_ps(n2y, invDet), _mm_mul_ps(n2z, invDet));
+		}
+#endif
+		for (; i < count; i++)
+			computeNormalMatrix(*advance(models, modelStride, i), advance(normals, normalStride, i));
+	}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+
+namespace myopengl {
+
+	// Calcula en lote la matriz normal (inversa transpuesta de la parte 3x3)
+	// de count matrices de modelo. Entrada y salida se recorren con un paso
+	// en bytes para poder leer y escribir directamente dentro de arreglos de
+	// estructuras (p. ej. los datos por instancia). Cada matriz normal se
+	// escribe como tres columnas vec4 con w = 0.
+	// Con SSE se procesan cuatro matrices a la vez.
+	void computeNormalMatrices(const glm::mat4* models, size_t modelStride,
+		glm::vec4* normals, size_t normalStride, size_t count);
+
+	// Versión escalar de referencia (una matriz)
+	void computeNormalMatrix(const glm::mat4& model, glm::vec4* normal);
+
+}
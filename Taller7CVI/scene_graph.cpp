@@ -0,0 +1,87 @@
+#include "scene_graph.hpp"
+
+namespace myopengl {
+
+	NodeId SceneGraph::createNode(NodeId parent)
+	{
+		NodeId node = (NodeId)parents.size();
+		parents.push_back(parent);
+		transforms.add(glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f));
+		locals.push_back(glm::mat4(1.0f));
+		worlds.push_back(glm::mat4(1.0f));
+		versions.push_back(0);
+		dirtyFlags.push_back(1);
+		changedFlags.push_back(0);
+		return node;
+	}
+
+	void SceneGraph::clear()
+	{
+		parents.clear();
+		transforms.clear();
+		locals.clear();
+		worlds.clear();
+		versions.clear();
+		dirtyFlags.clear();
+		changedFlags.clear();
+	}
+
+	void SceneGraph::setTranslation(NodeId node, const glm::vec3& translation)
+	{
+		transforms.setTranslation(node, translation);
+		dirtyFlags[node] = 1;
+	}
+
+	void SceneGraph::setRotation(NodeId node, const glm::quat& rotation)
+	{
+		transforms.setRotation(node, rotation);
+		dirtyFlags[node] = 1;
+	}
+
+	void SceneGraph::setScale(NodeId node, const glm::vec3& scale)
+	{
+		transforms.setScale(node, scale);
+		dirtyFlags[node] = 1;
+	}
+
+	void SceneGraph::setLocal(NodeId node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+	{
+		transforms.setTranslation(node, translation);
+		transforms.setRotation(node, rotation);
+		transforms.setScale(node, scale);
+		dirtyFlags[node] = 1;
+	}
+
+	int SceneGraph::update()
+	{
+		// Matrices locales modificadas: se componen en lote por tramos contiguos
+		size_t count = parents.size();
+		for (size_t first = 0; first < count;) {
+			if (!dirtyFlags[first]) {
+				first++;
+				continue;
+			}
+			size_t end = first + 1;
+			while (end < count && dirtyFlags[end])
+				end++;
+			composeTransforms(transforms, first, end - first, &locals[first]);
+			first = end;
+		}
+
+		int updated = 0;
+		for (size_t node = 0; node < count; node++) {
+			NodeId parent = parents[node];
+			// Un nodo se recalcula si cambió su transformación local o la de un ancestro
+			bool dirty = dirtyFlags[node] || (parent != INVALID_NODE && changedFlags[parent]);
+			changedFlags[node] = dirty ? 1 : 0;
+			if (!dirty)
+				continue;
+			worlds[node] = parent != INVALID_NODE ? worlds[parent] * locals[node] : locals[node];
+			versions[node]++;
+			dirtyFlags[node] = 0;
+			updated++;
+		}
+		return updated;
+	}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "myopengl.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace myopengl {
+
+	typedef int NodeId;
+	const NodeId INVALID_NODE = -1;
+
+	// Grafo de escena jerárquico con propagación de transformaciones por
+	// banderas de suciedad. Los nodos se guardan en arreglos planos y todo
+	// padre precede a sus hijos, así que update() recorre una sola vez en
+	// orden y solo recalcula la matriz de mundo de los nodos cuya
+	// transformación local (o la de algún ancestro) cambió. No hay
+	// recursión, por lo que la profundidad de anidamiento no está limitada.
+	// Las transformaciones locales se guardan en un TransformArray (SoA) y
+	// las matrices locales modificadas se componen en lote con SIMD.
+	class SceneGraph {
+	public:
+		// Crea un nodo con transformación identidad bajo parent
+		NodeId createNode(NodeId parent = INVALID_NODE);
+		void clear();
+
+		// Transformación local: world = world(parent) * T * R * S
+		void setTranslation(NodeId node, const glm::vec3& translation);
+		void setRotation(NodeId node, const glm::quat& rotation);
+		void setScale(NodeId node, const glm::vec3& scale);
+		void setLocal(NodeId node, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+
+		glm::vec3 translation(NodeId node) const { return transforms.translation(node); }
+		glm::quat rotation(NodeId node) const { return transforms.rotation(node); }
+		glm::vec3 scale(NodeId node) const { return transforms.scale(node); }
+
+		// Recalcula las matrices de mundo pendientes. Devuelve cuántas cambiaron.
+		int update();
+
+		NodeId parent(NodeId node) const { return parents[node]; }
+		const glm::mat4& world(NodeId node) const { return worlds[node]; }
+		// Se incrementa cada vez que cambia la matriz de mundo del nodo
+		uint32_t version(NodeId node) const { return versions[node]; }
+		// true si la matriz de mundo cambió en el último update()
+		bool changed(NodeId node) const { return changedFlags[node] != 0; }
+		int size() const { return (int)parents.size(); }
+
+	private:
+		std::vector<NodeId> parents;
+		TransformArray transforms;
+		std::vector<glm::mat4> locals;
+		std::vector<glm::mat4> worlds;
+		std::vector<uint32_t> versions;
+		std::vector<uint8_t> dirtyFlags;   // transformación local modificada
+		std::vector<uint8_t> changedFlags; // matriz de mundo recalculada
+	};
+
+}
@@ -0,0 +1,205 @@
+#include "shader_program.hpp"
+#include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+#include <iostream>
+
+namespace myopengl {
+
+	GLuint ShaderProgram::current = 0;
+
+	static GLuint compileShader(GLenum type, const char* source)
+	{
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		int success;
+		char infoLog[512];
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "Error al compilar shader: " << infoLog << std::endl;
+		}
+		return shader;
+	}
+
+	ShaderProgram::~ShaderProgram()
+	{
+		destroy();
+	}
+
+	void ShaderProgram::destroy()
+	{
+		if (program)
+			glDeleteProgram(program);
+		if (current == program)
+			current = 0;
+		program = 0;
+		slots.clear();
+	}
+
+	bool ShaderProgram::build(const char* vertexSource, const char* fragmentSource, const char* name)
+	{
+		return build(vertexSource, NULL, fragmentSource, name);
+	}
+
+	bool ShaderProgram::build(const char* vertexSource, const char* geometrySource, const char* fragmentSource, const char* name)
+	{
+		destroy();
+		programName = name;
+		GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+		GLuint geometryShader = geometrySource ? compileShader(GL_GEOMETRY_SHADER, geometrySource) : 0;
+		GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+		program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		if (geometryShader)
+			glAttachShader(program, geometryShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(vertexShader);
+		if (geometryShader)
+			glDeleteShader(geometryShader);
+		glDeleteShader(fragmentShader);
+		return resolve();
+	}
+
+	bool ShaderProgram::buildCompute(const char* computeSource, const char* name)
+	{
+		destroy();
+		programName = name;
+		GLuint computeShader = compileShader(GL_COMPUTE_SHADER, computeSource);
+		program = glCreateProgram();
+		glAttachShader(program, computeShader);
+		glLinkProgram(program);
+		glDeleteShader(computeShader);
+		return resolve();
+	}
+
+	bool ShaderProgram::resolve()
+	{
+		int success;
+		char infoLog[512];
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(program, 512, NULL, infoLog);
+			std::cout << "Error al enlazar programa " << programName << ": " << infoLog << std::endl;
+			return false;
+		}
+
+		// Resolver todos los uniforms activos una sola vez
+		slots.clear();
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<char> buffer(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++) {
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(program, i, maxLength, NULL, &size, &type, buffer.data());
+			std::string uniformName = buffer.data();
+			// Los arreglos se reportan como "nombre[0]": se registra cada elemento
+			bool isArray = uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0;
+			std::string baseName = isArray ? uniformName.substr(0, uniformName.size() - 3) : uniformName;
+			for (GLint element = 0; element < size; element++) {
+				UniformSlot slot;
+				slot.name = isArray ? baseName + "[" + std::to_string(element) + "]" : uniformName;
+				slot.location = glGetUniformLocation(program, slot.name.c_str());
+				slot.type = type;
+				slot.hasValue = false;
+				// Uniforms dentro de bloques no tienen ubicación propia
+				if (slot.location >= 0)
+					slots.push_back(slot);
+			}
+		}
+		return true;
+	}
+
+	void ShaderProgram::use()
+	{
+		glUseProgram(program);
+		current = program;
+	}
+
+	void ShaderProgram::invalidate()
+	{
+		for (UniformSlot& slot : slots)
+			slot.hasValue = false;
+	}
+
+	void ShaderProgram::bindUniformBlock(const char* blockName, GLuint binding)
+	{
+		GLuint index = glGetUniformBlockIndex(program, blockName);
+		if (index == GL_INVALID_INDEX) {
+			std::cout << "Bloque uniform " << blockName << " no encontrado en " << programName << std::endl;
+			return;
+		}
+		glUniformBlockBinding(program, index, binding);
+	}
+
+	int ShaderProgram::findSlot(const std::string& name, GLenum expectedType)
+	{
+		for (size_t i = 0; i < slots.size(); i++) {
+			if (slots[i].name != name)
+				continue;
+			if (expectedType != 0 && slots[i].type != expectedType)
+				std::cout << "Tipo incorrecto para el uniform " << name << " en " << programName << std::endl;
+			return (int)i;
+		}
+		return -1;
+	}
+
+	bool ShaderProgram::store(int slot, const void* data, size_t size)
+	{
+		UniformSlot& entry = slots[slot];
+		if (entry.hasValue && std::memcmp(entry.value, data, size) == 0) {
+			frameStats.skipped++;
+			return false;
+		}
+		// glUniform* actúa sobre el programa activo: quien llama a set()
+		// tiene que haberlo activado con use()
+		if (current != program) {
+			std::cout << "Error al asignar el uniform " << entry.name << ": el programa "
+				<< programName << " no está activo" << std::endl;
+			return false;
+		}
+		std::memcpy(entry.value, data, size);
+		entry.hasValue = true;
+		frameStats.uploads++;
+		return true;
+	}
+
+	void uploadUniform(GLint location, bool value)
+	{
+		glUniform1i(location, value ? 1 : 0);
+	}
+
+	void uploadUniform(GLint location, int value)
+	{
+		glUniform1i(location, value);
+	}
+
+	void uploadUniform(GLint location, float value)
+	{
+		glUniform1f(location, value);
+	}
+
+	void uploadUniform(GLint location, const glm::vec3& value)
+	{
+		glUniform3fv(location, 1, glm::value_ptr(value));
+	}
+
+	void uploadUniform(GLint location, const glm::vec4& value)
+	{
+		glUniform4fv(location, 1, glm::value_ptr(value));
+	}
+
+	void uploadUniform(GLint location, const glm::mat3& value)
+	{
+		glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+	void uploadUniform(GLint location, const glm::mat4& value)
+	{
+		glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+	}
+
+}
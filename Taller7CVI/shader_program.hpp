@@ -0,0 +1,130 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	class ShaderProgram;
+
+	// Handle tipado a un uniform resuelto al enlazar el programa.
+	// Un handle vacío (uniform inexistente u optimizado) ignora los set().
+	template <typename T>
+	class Uniform {
+	public:
+		Uniform() : program(nullptr), slot(-1) {}
+		void set(const T& value) const;
+		bool valid() const { return program != nullptr; }
+
+	private:
+		friend class ShaderProgram;
+		Uniform(ShaderProgram* program, int slot) : program(program), slot(slot) {}
+		ShaderProgram* program;
+		int slot;
+	};
+
+	// Contadores de subidas de uniforms desde el último resetStats()
+	struct UniformStats {
+		unsigned int uploads = 0;
+		unsigned int skipped = 0;
+	};
+
+	// Programa de shaders con caché de ubicaciones y valores de uniforms.
+	// Todos los uniforms activos se resuelven una sola vez al enlazar
+	// (glGetActiveUniform) y cada set() compara contra el último valor
+	// enviado para no repetir llamadas glUniform* redundantes. Como
+	// glUniform*, set() actúa sobre el programa activado con use().
+	class ShaderProgram {
+	public:
+		ShaderProgram() = default;
+		~ShaderProgram();
+		ShaderProgram(const ShaderProgram&) = delete;
+		ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+		// Compila, enlaza y resuelve los uniforms. Devuelve false si falla.
+		bool build(const char* vertexSource, const char* fragmentSource, const char* name);
+		// Igual, con un geometry shader entre ambos (puede ser NULL)
+		bool build(const char* vertexSource, const char* geometrySource, const char* fragmentSource, const char* name);
+		// Programa de cómputo (GL 4.3)
+		bool buildCompute(const char* computeSource, const char* name);
+		void use();
+		void destroy();
+		GLuint id() const { return program; }
+
+		template <typename T>
+		Uniform<T> uniform(const std::string& name);
+
+		// Asocia un bloque uniform del shader a un punto de enlace de UBO
+		void bindUniformBlock(const char* blockName, GLuint binding);
+
+		// Olvida los valores en caché (p. ej. si se modificó el programa por fuera)
+		void invalidate();
+
+		const UniformStats& stats() const { return frameStats; }
+		void resetStats() { frameStats = UniformStats(); }
+
+	private:
+		template <typename T> friend class Uniform;
+
+		struct UniformSlot {
+			std::string name;
+			GLint location;
+			GLenum type;
+			bool hasValue;
+			unsigned char value[sizeof(glm::mat4)];
+		};
+
+		// Comprueba el enlace y resuelve los uniforms activos
+		bool resolve();
+		int findSlot(const std::string& name, GLenum expectedType);
+		// Guarda el valor y devuelve true si hay que subirlo a la GPU
+		// (el programa tiene que estar activo)
+		bool store(int slot, const void* data, size_t size);
+		GLint location(int slot) const { return slots[slot].location; }
+
+		GLuint program = 0;
+		std::string programName;
+		std::vector<UniformSlot> slots;
+		UniformStats frameStats;
+
+		static GLuint current;
+	};
+
+	// Subidas tipadas (definidas en shader_program.cpp)
+	void uploadUniform(GLint location, bool value);
+	void uploadUniform(GLint location, int value);
+	void uploadUniform(GLint location, float value);
+	void uploadUniform(GLint location, const glm::vec3& value);
+	void uploadUniform(GLint location, const glm::vec4& value);
+	void uploadUniform(GLint location, const glm::mat3& value);
+	void uploadUniform(GLint location, const glm::mat4& value);
+
+	// Tipo GL esperado para cada tipo de C++ (0 = sin comprobación)
+	template <typename T> inline GLenum uniformGLType() { return 0; }
+	template <> inline GLenum uniformGLType<bool>() { return GL_BOOL; }
+	template <> inline GLenum uniformGLType<float>() { return GL_FLOAT; }
+	template <> inline GLenum uniformGLType<glm::vec3>() { return GL_FLOAT_VEC3; }
+	template <> inline GLenum uniformGLType<glm::vec4>() { return GL_FLOAT_VEC4; }
+	template <> inline GLenum uniformGLType<glm::mat3>() { return GL_FLOAT_MAT3; }
+	template <> inline GLenum uniformGLType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+	template <typename T>
+	Uniform<T> ShaderProgram::uniform(const std::string& name)
+	{
+		int slot = findSlot(name, uniformGLType<T>());
+		if (slot < 0)
+			return Uniform<T>();
+		return Uniform<T>(this, slot);
+	}
+
+	template <typename T>
+	void Uniform<T>::set(const T& value) const
+	{
+		if (!program)
+			return;
+		if (program->store(slot, &value, sizeof(T)))
+			uploadUniform(program->location(slot), value);
+	}
+
+}
@@ -0,0 +1,53 @@
+#include "shadow_cache.hpp"
+#include <cstring>
+
+namespace myopengl {
+
+	const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+
+	uint64_t ShadowCache::hash(uint64_t seed, uint32_t value)
+	{
+		for (int byte = 0; byte < 4; byte++) {
+			seed ^= (value >> (byte * 8)) & 0xFF;
+			seed *= FNV_PRIME;
+		}
+		return seed;
+	}
+
+	void ShadowCache::begin(const ShadowCascades& cascades)
+	{
+		if (cascades.count != count)
+			valid = 0;
+		count = cascades.count;
+		for (int c = 0; c < count; c++) {
+			// La firma empieza con los bits de la matriz de luz de la cascada
+			uint32_t words[16];
+			std::memcpy(words, &cascades.lightSpace[c], sizeof(words));
+			signatures[c] = FNV_OFFSET;
+			for (uint32_t word : words)
+				signatures[c] = hash(signatures[c], word);
+		}
+	}
+
+	unsigned int ShadowCache::resolve()
+	{
+		unsigned int dirty = 0;
+		for (int c = 0; c < count; c++) {
+			if (!(valid & (1u << c)) || signatures[c] != stored[c])
+				dirty |= 1u << c;
+			stored[c] = signatures[c];
+		}
+		valid = (1u << count) - 1;
+		for (int c = 0; c < count; c++) {
+			if (dirty & (1u << c))
+				cacheStats.renderedCascades++;
+			else
+				cacheStats.skippedCascades++;
+		}
+		if (!dirty)
+			cacheStats.skippedPasses++;
+		return dirty;
+	}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "shadow_cascades.hpp"
+#include <cstdint>
+
+namespace myopengl {
+
+	struct ShadowCacheStats {
+		unsigned int renderedCascades = 0;
+		unsigned int skippedCascades = 0;
+		unsigned int skippedPasses = 0; // frames sin pasada de sombras
+	};
+
+	// Caché de mapas de sombra por cascada. Cada frame se acumula una firma
+	// (hash FNV-1a) por cascada con su matriz de luz y con el índice y la
+	// versión de transformación de cada objeto que proyecta sombra en ella;
+	// solo se vuelven a dibujar las cascadas cuya firma cambió.
+	class ShadowCache {
+	public:
+		// Fuerza a redibujar todo (p. ej. al recrear el arreglo de mapas)
+		void invalidate() { valid = 0; }
+
+		void begin(const ShadowCascades& cascades);
+		void addCaster(int cascade, uint32_t object, uint32_t version)
+		{
+			signatures[cascade] = hash(hash(signatures[cascade], object), version);
+		}
+		// Máscara de cascadas que hay que redibujar; actualiza las firmas guardadas
+		unsigned int resolve();
+
+		const ShadowCacheStats& stats() const { return cacheStats; }
+		void resetStats() { cacheStats = ShadowCacheStats(); }
+
+	private:
+		static uint64_t hash(uint64_t seed, uint32_t value);
+
+		int count = 0;
+		uint64_t signatures[MAX_CASCADES] = {};
+		uint64_t stored[MAX_CASCADES] = {};
+		unsigned int valid = 0; // bit c: stored[c] corresponde al contenido de la capa c
+		ShadowCacheStats cacheStats;
+	};
+
+}
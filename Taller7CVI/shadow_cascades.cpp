@@ -0,0 +1,207 @@
+#include "shadow_cascades.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace myopengl {
+
+	ShadowCascades fitShadowCascades(const CascadeCamera& camera, const glm::vec3& lightDir,
+		int count, float shadowDistance, float lambda, const Aabb& sceneBounds,
+		int resolution, bool snapToTexels)
+	{
+		ShadowCascades cascades;
+		cascades.count = std::max(1, std::min(count, MAX_CASCADES));
+		glm::vec3 up = std::fabs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		// Vista de la luz fija (anclada al origen): un punto quieto del mundo
+		// conserva sus coordenadas de luz aunque la cámara se mueva
+		glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+		// Caja de la escena en espacio de luz
+		glm::vec3 sceneMin(1e30f), sceneMax(-1e30f);
+		for (int c = 0; c < 8; c++) {
+			glm::vec3 corner((c & 1) ? sceneBounds.max.x : sceneBounds.min.x,
+				(c & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+				(c & 4) ? sceneBounds.max.z : sceneBounds.min.z);
+			glm::vec3 lightCorner = glm::vec3(lightView * glm::vec4(corner, 1.0f));
+			sceneMin = glm::min(sceneMin, lightCorner);
+			sceneMax = glm::max(sceneMax, lightCorner);
+		}
+
+		float sliceNear = camera.nearPlane;
+		for (int i = 0; i < cascades.count; i++) {
+			// Esquema práctico: mezcla de la división logarítmica y la uniforme
+			float p = (i + 1) / (float)cascades.count;
+			float logSplit = camera.nearPlane * std::pow(shadowDistance / camera.nearPlane, p);
+			float uniformSplit = camera.nearPlane + (shadowDistance - camera.nearPlane) * p;
+			float sliceFar = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+
+			// Esquinas del trozo del frustum, en espacio de luz
+			glm::mat4 sliceProjection = glm::perspective(camera.fovy, camera.aspect, sliceNear, sliceFar);
+			glm::mat4 toWorld = glm::inverse(sliceProjection * camera.view);
+			glm::vec3 corners[8];
+			glm::vec3 center(0.0f);
+			glm::vec3 boxMin(1e30f), boxMax(-1e30f);
+			for (int c = 0; c < 8; c++) {
+				glm::vec4 corner = toWorld * glm::vec4((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f, (c & 4) ? 1.0f : -1.0f, 1.0f);
+				corners[c] = glm::vec3(corner) / corner.w;
+				center += corners[c] / 8.0f;
+				glm::vec3 lightCorner = glm::vec3(lightView * glm::vec4(corners[c], 1.0f));
+				boxMin = glm::min(boxMin, lightCorner);
+				boxMax = glm::max(boxMax, lightCorner);
+			}
+			// Intersección con la escena: no se gasta resolución en espacio vacío
+			glm::vec2 fitMin = glm::max(glm::vec2(boxMin), glm::vec2(sceneMin));
+			glm::vec2 fitMax = glm::max(glm::min(glm::vec2(boxMax), glm::vec2(sceneMax)), fitMin);
+
+			if (snapToTexels) {
+				// Tamaño independiente de la orientación de la cámara: el menor
+				// entre el diámetro de la esfera que contiene el trozo y la escena
+				float radius = 0.0f;
+				for (const glm::vec3& corner : corners)
+					radius = std::max(radius, glm::length(corner - center));
+				glm::vec2 size = glm::min(glm::vec2(2.0f * radius), glm::vec2(sceneMax - sceneMin));
+				glm::vec2 texel = size / (float)resolution;
+				glm::vec2 fitCenter = (fitMin + fitMax) * 0.5f;
+				fitMin = glm::floor((fitCenter - size * 0.5f) / texel) * texel;
+				fitMax = fitMin + size;
+			}
+
+			// La luz mira hacia -z: near/far son distancias a lo largo de la vista.
+			// El near cubre toda la escena hacia la luz; el far termina en el trozo.
+			float zNear = -sceneMax.z;
+			float zFar = std::min(-sceneMin.z, -boxMin.z);
+			glm::mat4 lightProjection = glm::ortho(fitMin.x, fitMax.x, fitMin.y, fitMax.y, zNear, zFar);
+
+			cascades.lightSpace[i] = lightProjection * lightView;
+			cascades.splitFar[i] = sliceFar;
+			cascades.depthRange[i] = zFar - zNear;
+			cascades.texelSize[i] = std::max(fitMax.x - fitMin.x, fitMax.y - fitMin.y) / resolution;
+			sliceNear = sliceFar;
+		}
+		return cascades;
+	}
+
+	const char* shadowFilterName(ShadowFilter filter)
+	{
+		switch (filter) {
+		case SHADOW_FILTER_HARD: return "hard";
+		case SHADOW_FILTER_HARDWARE: return "hardware 2x2";
+		case SHADOW_FILTER_PCF: return "PCF";
+		case SHADOW_FILTER_POISSON: return "Poisson";
+		case SHADOW_FILTER_VSM: return "VSM";
+		case SHADOW_FILTER_EVSM: return "EVSM";
+		default: return "?";
+		}
+	}
+
+	ShadowMapArray::~ShadowMapArray()
+	{
+		destroy();
+	}
+
+	bool ShadowMapArray::create(int resolution, int layers)
+	{
+		destroy();
+		size = resolution;
+		layerCount = layers;
+		glGenTextures(1, &depthTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, layers, 0,
+			GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+		// Muestreo: profundidad cruda (más cercano) y comparación por hardware
+		// (lineal: la GPU compara las 4 muestras vecinas y promedia)
+		GLuint samplers[2];
+		glGenSamplers(2, samplers);
+		depthSampler = samplers[0];
+		compareSampler = samplers[1];
+		for (GLuint sampler : samplers) {
+			GLint filter = sampler == compareSampler ? GL_LINEAR : GL_NEAREST;
+			glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, filter);
+			glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, filter);
+			glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, borderColor);
+		}
+		glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glSamplerParameteri(compareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		// glFramebufferTexture (sin capa) enlaza todas las capas: el geometry
+		// shader elige la capa de cada primitiva con gl_Layer
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+		layerFbos.resize(layers);
+		glGenFramebuffers(layers, layerFbos.data());
+		for (int layer = 0; layer < layers; layer++) {
+			glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[layer]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, layer);
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error al crear el framebuffer de sombras: 0x" << std::hex << status << std::dec << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void ShadowMapArray::clearLayers(unsigned int mask)
+	{
+		if (mask == (1u << layerCount) - 1) {
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			return;
+		}
+		for (int layer = 0; layer < layerCount; layer++) {
+			if (!(mask & (1u << layer)))
+				continue;
+			glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[layer]);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+
+	void ShadowMapArray::bind(GLuint depthUnit, GLuint compareUnit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + depthUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+		glBindSampler(depthUnit, depthSampler);
+		glActiveTexture(GL_TEXTURE0 + compareUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+		glBindSampler(compareUnit, compareSampler);
+	}
+
+	void ShadowMapArray::destroy()
+	{
+		if (!layerFbos.empty())
+			glDeleteFramebuffers((GLsizei)layerFbos.size(), layerFbos.data());
+		layerFbos.clear();
+		if (fbo)
+			glDeleteFramebuffers(1, &fbo);
+		if (depthTexture)
+			glDeleteTextures(1, &depthTexture);
+		if (depthSampler)
+			glDeleteSamplers(1, &depthSampler);
+		if (compareSampler)
+			glDeleteSamplers(1, &compareSampler);
+		fbo = 0;
+		depthTexture = 0;
+		depthSampler = 0;
+		compareSampler = 0;
+		size = 0;
+		layerCount = 0;
+	}
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "culling.hpp"
+#include <vector>
+
+namespace myopengl {
+
+	// Debe coincidir con el tamaño de lightSpaceMatrices[] en los shaders
+	const int MAX_CASCADES = 4;
+
+	// Parámetros de la cámara que se reparte entre las cascadas
+	struct CascadeCamera {
+		glm::mat4 view;
+		float fovy;
+		float aspect;
+		float nearPlane;
+	};
+
+	// Matriz de luz de cada cascada y la profundidad (en espacio de vista,
+	// positiva) donde termina cada una
+	struct ShadowCascades {
+		int count = 0;
+		glm::mat4 lightSpace[MAX_CASCADES];
+		float splitFar[MAX_CASCADES];
+		float depthRange[MAX_CASCADES]; // extensión en z de cada proyección ortográfica
+		float texelSize[MAX_CASCADES];  // unidades de mundo por texel del mapa
+	};
+
+	// Divide [near, shadowDistance] mezclando la división logarítmica y la
+	// uniforme (lambda = 1: logarítmica) y ajusta una proyección ortográfica
+	// a cada trozo del frustum intersecado con la caja de la escena, vista
+	// desde la luz. El rango z sale de la caja de la escena, así que incluye
+	// los objetos que proyectan sombra aunque estén fuera de la cámara.
+	// Con snapToTexels el tamaño de cada cascada no depende de la orientación
+	// de la cámara y su origen se mueve de a un texel, lo que evita el
+	// parpadeo de los bordes de sombra al mover la cámara.
+	ShadowCascades fitShadowCascades(const CascadeCamera& camera, const glm::vec3& lightDir,
+		int count, float shadowDistance, float lambda, const Aabb& sceneBounds,
+		int resolution, bool snapToTexels);
+
+	// Filtrado de sombras en la pasada de iluminación (uniform shadowFilter)
+	enum ShadowFilter {
+		SHADOW_FILTER_HARD,     // una muestra con comparación manual
+		SHADOW_FILTER_HARDWARE, // una muestra con comparación por hardware (PCF bilineal 2x2)
+		SHADOW_FILTER_PCF,      // (2r+1)^2 muestras con comparación por hardware
+		SHADOW_FILTER_POISSON,  // disco de Poisson rotado por píxel
+		SHADOW_FILTER_VSM,      // momentos prefiltrados (ver ShadowMomentArray)
+		SHADOW_FILTER_EVSM,     // momentos exponenciales prefiltrados
+		SHADOW_FILTER_COUNT
+	};
+
+	const char* shadowFilterName(ShadowFilter filter);
+
+	// Arreglo de texturas de profundidad (una capa por cascada) con su
+	// framebuffer enlazado en modo por capas para dibujar todas en una pasada
+	class ShadowMapArray {
+	public:
+		ShadowMapArray() = default;
+		~ShadowMapArray();
+		ShadowMapArray(const ShadowMapArray&) = delete;
+		ShadowMapArray& operator=(const ShadowMapArray&) = delete;
+
+		bool create(int resolution, int layers);
+		void destroy();
+		// Borra la profundidad de las capas indicadas (bit c = capa c). El
+		// framebuffer por capas no permite borrar solo algunas, así que
+		// cada capa tiene además su propio framebuffer.
+		void clearLayers(unsigned int mask);
+
+		// Vincula el arreglo a dos unidades: en depthUnit se lee la
+		// profundidad tal cual (sampler2DArray) y en compareUnit se compara
+		// por hardware con filtrado lineal (sampler2DArrayShadow). Cada
+		// unidad usa su propio sampler, así que la textura no cambia.
+		void bind(GLuint depthUnit, GLuint compareUnit) const;
+
+		GLuint texture() const { return depthTexture; }
+		GLuint framebuffer() const { return fbo; }
+		int resolution() const { return size; }
+		int layers() const { return layerCount; }
+
+	private:
+		GLuint depthTexture = 0;
+		GLuint depthSampler = 0;
+		GLuint compareSampler = 0;
+		GLuint fbo = 0;
+		std::vector<GLuint> layerFbos;
+		int size = 0;
+		int layerCount = 0;
+	};
+
+}
@@ -0,0 +1,264 @@
+#include "shadow_moments.hpp"
+#include "shadow_cascades.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace myopengl {
+
+	// Triángulo que cubre la pantalla, sin vértices en buffer
+	static const char* fullscreenVertexSource = R"(
+#version 330 core
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	// Momentos de cada texel de profundidad, promediados en bloques de
+	// downsample x downsample y desenfocados en x (a resolución reducida)
+	static const char* momentsFragmentSource = R"(
+#version 330 core
+out vec4 Moments;
+uniform sampler2DArray depthMap;
+uniform int layer;
+uniform int radius;
+uniform int downsample;
+uniform int exponential;
+uniform float positiveExponent;
+uniform float negativeExponent;
+uniform float weights[9];
+
+vec4 computeMoments(float depth)
+{
+    if(exponential == 0)
+        return vec4(depth, depth * depth, 0.0, 0.0);
+    // EVSM: la profundidad se lleva a [-1, 1] antes de la exponencial
+    float warped = 2.0 * depth - 1.0;
+    float positive = exp(positiveExponent * warped);
+    float negative = -exp(-negativeExponent * warped);
+    return vec4(positive, positive * positive, negative, negative * negative);
+}
+
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 sourceMax = textureSize(depthMap, 0).xy - 1;
+    vec4 sum = vec4(0.0);
+    for(int i = -radius; i <= radius; i++) {
+        vec4 block = vec4(0.0);
+        for(int y = 0; y < downsample; y++) {
+            for(int x = 0; x < downsample; x++) {
+                ivec2 source = clamp(ivec2((texel.x + i) * downsample + x, texel.y * downsample + y), ivec2(0), sourceMax);
+                block += computeMoments(texelFetch(depthMap, ivec3(source, layer), 0).r);
+            }
+        }
+        sum += weights[abs(i)] * block;
+    }
+    Moments = sum / float(downsample * downsample);
+}
+)";
+
+	// Segunda mitad del gaussiano separable: desenfoque en y
+	static const char* blurFragmentSource = R"(
+#version 330 core
+out vec4 Moments;
+uniform sampler2D source;
+uniform int radius;
+uniform float weights[9];
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int maxY = textureSize(source, 0).y - 1;
+    vec4 sum = vec4(0.0);
+    for(int i = -radius; i <= radius; i++)
+        sum += weights[abs(i)] * texelFetch(source, ivec2(texel.x, clamp(texel.y + i, 0, maxY)), 0);
+    Moments = sum;
+}
+)";
+
+	ShadowMomentArray::~ShadowMomentArray()
+	{
+		destroy();
+	}
+
+	bool ShadowMomentArray::buildPrograms()
+	{
+		if (!momentsProgram.build(fullscreenVertexSource, momentsFragmentSource, "de momentos")
+			|| !blurProgram.build(fullscreenVertexSource, blurFragmentSource, "de desenfoque"))
+			return false;
+		momentsLayer = momentsProgram.uniform<int>("layer");
+		momentsRadius = momentsProgram.uniform<int>("radius");
+		momentsDownsample = momentsProgram.uniform<int>("downsample");
+		momentsExponential = momentsProgram.uniform<int>("exponential");
+		blurRadius = blurProgram.uniform<int>("radius");
+		for (int i = 0; i <= MAX_MOMENT_BLUR_RADIUS; i++) {
+			std::string name = "weights[" + std::to_string(i) + "]";
+			momentsWeights[i] = momentsProgram.uniform<float>(name);
+			blurWeights[i] = blurProgram.uniform<float>(name);
+		}
+		momentsProgram.use();
+		momentsProgram.uniform<int>("depthMap").set(0);
+		momentsProgram.uniform<float>("positiveExponent").set(EVSM_POSITIVE_EXPONENT);
+		momentsProgram.uniform<float>("negativeExponent").set(EVSM_NEGATIVE_EXPONENT);
+		blurProgram.use();
+		blurProgram.uniform<int>("source").set(0);
+		return true;
+	}
+
+	bool ShadowMomentArray::create(int depthResolution, int layers, int downsample, bool exponential)
+	{
+		destroy();
+		if (!buildPrograms())
+			return false;
+		depthSize = depthResolution;
+		reduction = std::max(downsample, 1);
+		size = std::max(depthResolution / reduction, 1);
+		layerCount = layers;
+		exponentialMoments = exponential;
+		GLenum internalFormat = exponential ? GL_RGBA32F : GL_RG32F;
+		GLenum format = exponential ? GL_RGBA : GL_RG;
+
+		int levels = 1;
+		while ((size >> levels) > 0)
+			levels++;
+		glGenTextures(1, &momentTexture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, momentTexture);
+		for (int level = 0; level < levels; level++) {
+			int levelSize = std::max(size >> level, 1);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, levelSize, levelSize, layers, 0, format, GL_FLOAT, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+		glGenTextures(1, &blurTexture);
+		glBindTexture(GL_TEXTURE_2D, blurTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, format, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+		// Fuera del mapa: momentos de la profundidad máxima (sin sombra)
+		float farPositive = std::exp(EVSM_POSITIVE_EXPONENT);
+		float farNegative = -std::exp(-EVSM_NEGATIVE_EXPONENT);
+		float borderVsm[] = { 1.0f, 1.0f, 0.0f, 0.0f };
+		float borderEvsm[] = { farPositive, farPositive * farPositive, farNegative, farNegative * farNegative };
+		glGenSamplers(1, &sampler);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, exponential ? borderEvsm : borderVsm);
+
+		glGenVertexArrays(1, &emptyVao);
+
+		glGenFramebuffers(1, &blurFbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, blurFbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		layerFbos.resize(layers);
+		glGenFramebuffers(layers, layerFbos.data());
+		for (int layer = 0; layer < layers && status == GL_FRAMEBUFFER_COMPLETE; layer++) {
+			glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[layer]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, momentTexture, 0, layer);
+			status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "Error al crear el framebuffer de momentos: 0x" << std::hex << status << std::dec << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool ShadowMomentArray::matches(int depthResolution, int layers, int downsample, bool exponential) const
+	{
+		return momentTexture && depthSize == depthResolution && layerCount == layers
+			&& reduction == std::max(downsample, 1) && exponentialMoments == exponential;
+	}
+
+	void ShadowMomentArray::update(const ShadowMapArray& depth, unsigned int layerMask, int radius)
+	{
+		if (!momentTexture || !layerMask)
+			return;
+		radius = std::max(0, std::min(radius, MAX_MOMENT_BLUR_RADIUS));
+		// Pesos gaussianos normalizados para [-radius, radius]
+		float weights[MAX_MOMENT_BLUR_RADIUS + 1] = {};
+		float sigma = std::max(radius * 0.5f, 0.5f);
+		float total = 0.0f;
+		for (int i = 0; i <= radius; i++) {
+			weights[i] = std::exp(-(i * i) / (2.0f * sigma * sigma));
+			total += i == 0 ? weights[i] : 2.0f * weights[i];
+		}
+		momentsProgram.use();
+		for (int i = 0; i <= radius; i++)
+			momentsWeights[i].set(weights[i] / total);
+		momentsRadius.set(radius);
+		momentsDownsample.set(reduction);
+		momentsExponential.set(exponentialMoments ? 1 : 0);
+		blurProgram.use();
+		for (int i = 0; i <= radius; i++)
+			blurWeights[i].set(weights[i] / total);
+		blurRadius.set(radius);
+
+		glViewport(0, 0, size, size);
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(emptyVao);
+		glActiveTexture(GL_TEXTURE0);
+		for (int layer = 0; layer < layerCount; layer++) {
+			if (!(layerMask & (1u << layer)))
+				continue;
+			// Profundidad -> momentos reducidos y desenfocados en x
+			glBindFramebuffer(GL_FRAMEBUFFER, blurFbo);
+			momentsProgram.use();
+			momentsLayer.set(layer);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, depth.texture());
+			glBindSampler(0, 0);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			// Desenfoque en y hacia la capa de la cascada
+			glBindFramebuffer(GL_FRAMEBUFFER, layerFbos[layer]);
+			blurProgram.use();
+			glBindTexture(GL_TEXTURE_2D, blurTexture);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, momentTexture);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glEnable(GL_DEPTH_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void ShadowMomentArray::bind(GLuint unit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, momentTexture);
+		glBindSampler(unit, sampler);
+	}
+
+	void ShadowMomentArray::destroy()
+	{
+		if (!layerFbos.empty())
+			glDeleteFramebuffers((GLsizei)layerFbos.size(), layerFbos.data());
+		layerFbos.clear();
+		if (blurFbo)
+			glDeleteFramebuffers(1, &blurFbo);
+		if (momentTexture)
+			glDeleteTextures(1, &momentTexture);
+		if (blurTexture)
+			glDeleteTextures(1, &blurTexture);
+		if (sampler)
+			glDeleteSamplers(1, &sampler);
+		if (emptyVao)
+			glDeleteVertexArrays(1, &emptyVao);
+		momentsProgram.destroy();
+		blurProgram.destroy();
+		blurFbo = 0;
+		momentTexture = 0;
+		blurTexture = 0;
+		sampler = 0;
+		emptyVao = 0;
+		size = 0;
+		layerCount = 0;
+		depthSize = 0;
+	}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+#include "shader_program.hpp"
+
+namespace myopengl {
+
+	class ShadowMapArray;
+
+	const int MAX_MOMENT_BLUR_RADIUS = 8;
+	// Exponentes de EVSM (positivo y negativo); el positivo está limitado
+	// por el rango de float32 al guardar exp(2c)
+	const float EVSM_POSITIVE_EXPONENT = 40.0f;
+	const float EVSM_NEGATIVE_EXPONENT = 5.0f;
+
+	// Mapas de momentos para sombras por varianza (VSM: d, d² en RG32F) o
+	// exponenciales (EVSM: e^(c·d), e^(2c·d) y sus negativos en RGBA32F), una
+	// capa por cascada. Los momentos se calculan a partir del arreglo de
+	// profundidad a resolución reducida, se desenfocan con un gaussiano
+	// separable y se generan mipmaps, así que el costo por fragmento es una
+	// sola muestra trilineal sin importar el tamaño del filtro.
+	class ShadowMomentArray {
+	public:
+		ShadowMomentArray() = default;
+		~ShadowMomentArray();
+		ShadowMomentArray(const ShadowMomentArray&) = delete;
+		ShadowMomentArray& operator=(const ShadowMomentArray&) = delete;
+
+		// downsample: divisor de la resolución del mapa de profundidad
+		bool create(int depthResolution, int layers, int downsample, bool exponential);
+		void destroy();
+
+		// Recalcula las capas indicadas (bit c = capa c) a partir de la
+		// profundidad y regenera los mipmaps. Cambia el framebuffer, el
+		// viewport y el programa activos.
+		void update(const ShadowMapArray& depth, unsigned int layerMask, int blurRadius);
+
+		// Vincula los momentos (filtrado trilineal) a la unidad indicada
+		void bind(GLuint unit) const;
+
+		bool matches(int depthResolution, int layers, int downsample, bool exponential) const;
+		int resolution() const { return size; }
+
+	private:
+		bool buildPrograms();
+
+		ShaderProgram momentsProgram; // momentos + reducción + desenfoque horizontal
+		ShaderProgram blurProgram;    // desenfoque vertical
+		Uniform<int> momentsLayer, momentsRadius, momentsDownsample, momentsExponential;
+		Uniform<int> blurRadius;
+		Uniform<float> momentsWeights[MAX_MOMENT_BLUR_RADIUS + 1];
+		Uniform<float> blurWeights[MAX_MOMENT_BLUR_RADIUS + 1];
+
+		GLuint momentTexture = 0;
+		GLuint blurTexture = 0; // resultado intermedio (una capa)
+		GLuint blurFbo = 0;
+		GLuint sampler = 0;
+		GLuint emptyVao = 0;    // triángulo de pantalla completa generado con gl_VertexID
+		std::vector<GLuint> layerFbos;
+		int size = 0;
+		int layerCount = 0;
+		int depthSize = 0;
+		int reduction = 1;
+		bool exponentialMoments = false;
+	};
+
+}
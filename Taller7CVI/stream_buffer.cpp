@@ -0,0 +1,113 @@
+#include "stream_buffer.hpp"
+#include <chrono>
+#include <cstring>
+
+namespace myopengl {
+
+	StreamBuffer::~StreamBuffer()
+	{
+		destroy();
+	}
+
+	void StreamBuffer::create(GLsizeiptr size, int count)
+	{
+		destroy();
+		sliceSize = size;
+		sliceCount = count;
+		current = count - 1;
+		head = 0;
+		flushed = 0;
+		fences.assign(count, (GLsync)0);
+
+		GLsizeiptr total = sliceSize * sliceCount;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, total, NULL, flags);
+			mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, total, flags);
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, total, NULL, GL_STREAM_DRAW);
+			staging.resize(sliceSize);
+		}
+	}
+
+	void StreamBuffer::destroy()
+	{
+		for (GLsync& fence : fences) {
+			if (fence)
+				glDeleteSync(fence);
+			fence = 0;
+		}
+		if (buffer) {
+			if (mapped) {
+				glBindBuffer(GL_ARRAY_BUFFER, buffer);
+				glUnmapBuffer(GL_ARRAY_BUFFER);
+			}
+			glDeleteBuffers(1, &buffer);
+		}
+		buffer = 0;
+		mapped = nullptr;
+		staging.clear();
+	}
+
+	void StreamBuffer::beginFrame()
+	{
+		current = (current + 1) % sliceCount;
+		head = 0;
+		flushed = 0;
+		frameStats.frames++;
+		frameStats.lastWaitMs = 0.0;
+
+		GLsync& fence = fences[current];
+		if (!fence)
+			return;
+		// Consulta sin espera: si ya terminó no cuenta como bloqueo
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+			auto start = std::chrono::high_resolution_clock::now();
+			const GLuint64 timeout = 1000000; // 1 ms por intento
+			do {
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+			} while (status == GL_TIMEOUT_EXPIRED);
+			double waited = std::chrono::duration<double, std::milli>(
+				std::chrono::high_resolution_clock::now() - start).count();
+			frameStats.stalls++;
+			frameStats.lastWaitMs = waited;
+			frameStats.totalWaitMs += waited;
+			if (waited > frameStats.maxWaitMs)
+				frameStats.maxWaitMs = waited;
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	void* StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset)
+	{
+		// Se alinea el offset en el buffer y no dentro del slice: sliceSize
+		// no tiene por qué ser múltiplo de la alineación pedida
+		GLsizeiptr base = current * sliceSize;
+		GLsizeiptr start = (base + head + alignment - 1) / alignment * alignment - base;
+		if (start + size > sliceSize)
+			return nullptr;
+		head = start + size;
+		offset = base + start;
+		return mapped ? mapped + offset : staging.data() + start;
+	}
+
+	void StreamBuffer::flush()
+	{
+		if (mapped || head == flushed)
+			return;
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, current * sliceSize + flushed, head - flushed, staging.data() + flushed);
+		flushed = head;
+	}
+
+	void StreamBuffer::endFrame()
+	{
+		fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+
+namespace myopengl {
+
+	// Estadísticas de espera de la CPU sobre los fences del anillo
+	struct StreamBufferStats {
+		unsigned int frames = 0;
+		unsigned int stalls = 0;     // frames en que el slice aún estaba en uso
+		double totalWaitMs = 0.0;
+		double maxWaitMs = 0.0;
+		double lastWaitMs = 0.0;
+	};
+
+	// Buffer de streaming para datos dinámicos por frame. Se reserva con
+	// glBufferStorage y queda mapeado de forma persistente y coherente;
+	// se divide en N slices (uno por frame en vuelo) protegidos por
+	// glFenceSync, de modo que la CPU solo espera si la GPU va N frames atrás.
+	// Sin GL 4.4 / ARB_buffer_storage se usa una copia en CPU y glBufferSubData.
+	class StreamBuffer {
+	public:
+		StreamBuffer() = default;
+		~StreamBuffer();
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+		void create(GLsizeiptr sliceSize, int sliceCount);
+		void destroy();
+
+		// Pasa al siguiente slice, esperando su fence si la GPU aún lo usa
+		void beginFrame();
+		// Reserva size bytes alineados dentro del slice actual. Devuelve el
+		// puntero de escritura (o nullptr si no cabe) y el offset en el buffer.
+		void* allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset);
+		// Hace visibles a la GPU los datos escritos (solo en el modo sin mapeo)
+		void flush();
+		// Coloca el fence del slice actual tras los comandos que lo leen
+		void endFrame();
+
+		GLuint id() const { return buffer; }
+		bool persistent() const { return mapped != nullptr; }
+		int slices() const { return sliceCount; }
+		GLsizeiptr sliceBytes() const { return sliceSize; }
+		GLsizeiptr usedBytes() const { return head; }
+		const StreamBufferStats& stats() const { return frameStats; }
+		void resetStats() { frameStats = StreamBufferStats(); }
+
+	private:
+		GLuint buffer = 0;
+		unsigned char* mapped = nullptr;
+		std::vector<unsigned char> staging;
+		std::vector<GLsync> fences;
+		GLsizeiptr sliceSize = 0;
+		int sliceCount = 0;
+		int current = 0;
+		GLsizeiptr head = 0;
+		GLsizeiptr flushed = 0;
+		StreamBufferStats frameStats;
+	};
+
+}
@@ -0,0 +1,120 @@
+#include "texture_array.hpp"
+
+namespace myopengl {
+
+	// Triángulo que cubre la capa, con coordenadas de textura de 0 a 1
+	static const char* copyVertexSource = R"(
+#version 330 core
+out vec2 TexCoord;
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+	// Las derivadas de TexCoord eligen el mipmap de la fuente según la
+	// relación entre su tamaño y el de la capa
+	static const char* copyFragmentSource = R"(
+#version 330 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D source;
+void main()
+{
+    FragColor = texture(source, TexCoord);
+}
+)";
+
+	TextureArray::~TextureArray()
+	{
+		destroy();
+	}
+
+	bool TextureArray::create(int layerSize, int layerCount)
+	{
+		destroy();
+		if (!copyProgram.build(copyVertexSource, copyFragmentSource, "de copia a capas"))
+			return false;
+		copyProgram.use();
+		copyProgram.uniform<int>("source").set(0);
+
+		size = layerSize;
+		sources.assign(layerCount, 0);
+		generations.assign(layerCount, 0);
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		int levels = 0;
+		for (int levelSize = layerSize; levelSize > 0; levelSize /= 2, levels++)
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, levelSize, levelSize, layerCount, 0,
+				GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glGenFramebuffers(1, &fbo);
+		glGenVertexArrays(1, &emptyVao);
+		return true;
+	}
+
+	void TextureArray::destroy()
+	{
+		if (texture)
+			glDeleteTextures(1, &texture);
+		if (fbo)
+			glDeleteFramebuffers(1, &fbo);
+		if (emptyVao)
+			glDeleteVertexArrays(1, &emptyVao);
+		copyProgram.destroy();
+		texture = 0;
+		fbo = 0;
+		emptyVao = 0;
+		size = 0;
+		sources.clear();
+		generations.clear();
+		dirty = false;
+		copyCount = 0;
+	}
+
+	void TextureArray::setLayer(int layer, GLuint source, uint64_t generation)
+	{
+		if (!texture || (sources[layer] == source && generations[layer] == generation))
+			return;
+		sources[layer] = source;
+		generations[layer] = generation;
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0, layer);
+		glViewport(0, 0, size, size);
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(emptyVao);
+		copyProgram.use();
+		glActiveTexture(GL_TEXTURE0);
+		glBindSampler(0, 0);
+		glBindTexture(GL_TEXTURE_2D, source);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glEnable(GL_DEPTH_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		dirty = true;
+		copyCount++;
+	}
+
+	void TextureArray::update()
+	{
+		if (!dirty)
+			return;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		dirty = false;
+	}
+
+	void TextureArray::bind(GLuint unit) const
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	}
+
+}
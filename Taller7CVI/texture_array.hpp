@@ -0,0 +1,51 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
+#include "shader_program.hpp"
+
+namespace myopengl {
+
+	// Texturas de material en un GL_TEXTURE_2D_ARRAY (RGBA8, con mipmaps):
+	// todas las capas tienen el mismo tamaño y se vinculan con una sola
+	// unidad, así que cualquier combinación de materiales se dibuja en el
+	// mismo lote y el shader elige la capa con un índice, sin ramas por
+	// sampler. Cada capa se copia de una textura 2D dibujando un triángulo
+	// a pantalla completa: la fuente se reescala con su propio filtrado y
+	// puede tener cualquier tamaño o formato (también comprimido).
+	class TextureArray {
+	public:
+		TextureArray() = default;
+		~TextureArray();
+		TextureArray(const TextureArray&) = delete;
+		TextureArray& operator=(const TextureArray&) = delete;
+
+		bool create(int layerSize, int layerCount);
+		void destroy();
+
+		// Copia source a la capa si es otra textura que la última copiada:
+		// cambia el nombre o la generación (ver TextureCache::generation).
+		// Deja vinculado el framebuffer 0; el viewport queda cambiado.
+		void setLayer(int layer, GLuint source, uint64_t generation);
+		// Regenera los mipmaps si alguna capa cambió
+		void update();
+		void bind(GLuint unit) const;
+
+		int layerSize() const { return size; }
+		int layers() const { return (int)sources.size(); }
+		// Copias de capas hechas desde create()
+		int copies() const { return copyCount; }
+
+	private:
+		ShaderProgram copyProgram;
+		GLuint texture = 0;
+		GLuint fbo = 0;
+		GLuint emptyVao = 0;
+		int size = 0;
+		std::vector<GLuint> sources; // textura copiada en cada capa
+		std::vector<uint64_t> generations;
+		bool dirty = false;
+		int copyCount = 0;
+	};
+
+}
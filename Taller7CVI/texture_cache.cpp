@@ -0,0 +1,152 @@
+#include "texture_cache.hpp"
+#include "texture_loader.hpp"
+#include <algorithm>
+
+namespace myopengl {
+
+	TextureCache::~TextureCache()
+	{
+		destroy();
+	}
+
+	void TextureCache::create(TextureLoader& textureLoader, size_t budget)
+	{
+		destroy();
+		loader = &textureLoader;
+		budgetBytes = budget;
+	}
+
+	void TextureCache::destroy()
+	{
+		for (Record& record : records) {
+			if (record.loaderHandle >= 0)
+				loader->release(record.loaderHandle);
+		}
+		records.clear();
+		byPath.clear();
+		cacheStats = TextureCacheStats();
+		frame = 0;
+	}
+
+	int TextureCache::acquire(const std::string& path)
+	{
+		auto found = byPath.find(path);
+		int handle;
+		if (found != byPath.end()) {
+			handle = found->second;
+			if (records[handle].loaderHandle >= 0) {
+				cacheStats.hits++;
+			}
+			else {
+				// Desalojada: se vuelve a leer del disco
+				cacheStats.misses++;
+				records[handle].loaderHandle = loader->load(path);
+				records[handle].generation = ++nextGeneration;
+			}
+		}
+		else {
+			cacheStats.misses++;
+			handle = (int)records.size();
+			Record record;
+			record.path = path;
+			record.loaderHandle = loader->load(path);
+			record.content = handle;
+			record.generation = ++nextGeneration;
+			records.push_back(record);
+			byPath[path] = handle;
+		}
+		records[handle].refs++;
+		records[handle].lastUse = frame;
+		return handle;
+	}
+
+	void TextureCache::release(int handle)
+	{
+		if (records[handle].refs > 0)
+			records[handle].refs--;
+	}
+
+	GLuint TextureCache::texture(int handle)
+	{
+		Record& record = records[handle];
+		if (record.loaderHandle < 0)
+			return loader->placeholderTexture();
+		record.lastUse = frame;
+		records[record.content].lastUse = frame;
+		return loader->texture(record.loaderHandle);
+	}
+
+	void TextureCache::update()
+	{
+		frame++;
+		// Contenido repetido: el cargador no lo subió y apunta al original
+		for (int i = 0; i < (int)records.size(); i++) {
+			Record& record = records[i];
+			if (record.loaderHandle < 0 || record.content != i)
+				continue;
+			int original = loader->original(record.loaderHandle);
+			if (original < 0)
+				continue;
+			for (int j = 0; j < (int)records.size(); j++) {
+				if (j != i && records[j].content == j && records[j].loaderHandle == original) {
+					record.content = j;
+					cacheStats.shared++;
+					break;
+				}
+			}
+		}
+
+		// Referencias y último uso por textura: las copias cuentan para su dueño
+		std::vector<int> refs(records.size(), 0);
+		std::vector<uint64_t> lastUse(records.size(), 0);
+		for (const Record& record : records) {
+			refs[record.content] += record.refs;
+			lastUse[record.content] = std::max(lastUse[record.content], record.lastUse);
+		}
+		cacheStats.resident = 0;
+		cacheStats.residentBytes = 0;
+		for (int i = 0; i < (int)records.size(); i++) {
+			if (records[i].content != i || records[i].loaderHandle < 0)
+				continue;
+			size_t bytes = loader->residentBytes(records[i].loaderHandle);
+			if (bytes > 0) {
+				cacheStats.resident++;
+				cacheStats.residentBytes += bytes;
+			}
+		}
+
+		// Desalojo LRU de lo que no tiene referencias
+		while (cacheStats.residentBytes > budgetBytes) {
+			int victim = -1;
+			for (int i = 0; i < (int)records.size(); i++) {
+				if (records[i].content != i || records[i].loaderHandle < 0 || refs[i] > 0)
+					continue;
+				if (loader->residentBytes(records[i].loaderHandle) == 0)
+					continue;
+				if (victim < 0 || lastUse[i] < lastUse[victim])
+					victim = i;
+			}
+			if (victim < 0)
+				break;
+			cacheStats.resident--;
+			cacheStats.residentBytes -= loader->residentBytes(records[victim].loaderHandle);
+			evict(victim);
+		}
+		cacheStats.budget = budgetBytes;
+	}
+
+	void TextureCache::evict(int content)
+	{
+		for (int i = 0; i < (int)records.size(); i++) {
+			Record& record = records[i];
+			if (record.content != content || record.loaderHandle < 0)
+				continue;
+			loader->release(record.loaderHandle);
+			record.loaderHandle = -1;
+			record.content = i;
+			record.generation = ++nextGeneration;
+		}
+		cacheStats.evictions++;
+	}
+
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace myopengl {
+
+	class TextureLoader;
+
+	struct TextureCacheStats {
+		int hits = 0;               // acquire() de una ruta ya cargada
+		int misses = 0;             // acquire() que tuvo que leer el archivo
+		int shared = 0;             // rutas distintas con el mismo contenido
+		int evictions = 0;
+		int resident = 0;           // texturas en la GPU (sin contar copias)
+		size_t residentBytes = 0;
+		size_t budget = 0;
+	};
+
+	// Caché de texturas sobre TextureLoader. acquire() busca por ruta y
+	// suma una referencia; cuando la imagen se decodifica, el cargador la
+	// identifica por el hash de su contenido y, si ya hay otra igual, las
+	// dos rutas comparten la misma textura. Las texturas sin referencias
+	// siguen en la GPU hasta que la memoria residente pasa del presupuesto;
+	// entonces se liberan las usadas hace más tiempo. Las que tienen
+	// referencias nunca se liberan, aunque se pase del presupuesto.
+	class TextureCache {
+	public:
+		TextureCache() = default;
+		~TextureCache();
+		TextureCache(const TextureCache&) = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+
+		void create(TextureLoader& loader, size_t budgetBytes);
+		void destroy();
+
+		// Devuelve un identificador estable para la ruta (+1 referencia)
+		int acquire(const std::string& path);
+		// -1 referencia; la textura queda en caché hasta que se la desaloje
+		void release(int handle);
+
+		// Textura para dibujar (la provisoria mientras carga); la marca
+		// como usada en este frame
+		GLuint texture(int handle);
+		// Cambia cada vez que la ruta pasa a otra textura (carga, recarga o
+		// desalojo): un nombre de GL liberado puede reutilizarse para otro
+		// contenido, así que solo el par nombre + generación la identifica
+		uint64_t generation(int handle) const { return records[handle].generation; }
+		const std::string& path(int handle) const { return records[handle].path; }
+
+		// Una vez por frame, después de TextureLoader::update(): enlaza el
+		// contenido repetido y desaloja lo que sobre del presupuesto
+		void update();
+
+		void setBudget(size_t bytes) { budgetBytes = bytes; }
+		const TextureCacheStats& stats() const { return cacheStats; }
+
+	private:
+		struct Record {
+			std::string path;
+			int loaderHandle = -1;  // -1: desalojada, se recarga al pedirla
+			int content = -1;       // registro dueño de la textura (él mismo si no es copia)
+			int refs = 0;
+			uint64_t lastUse = 0;
+			uint64_t generation = 0;
+		};
+
+		void evict(int content);
+
+		TextureLoader* loader = nullptr;
+		size_t budgetBytes = 0;
+		uint64_t frame = 0;
+		uint64_t nextGeneration = 0;
+		std::vector<Record> records;
+		std::unordered_map<std::string, int> byPath;
+		TextureCacheStats cacheStats;
+	};
+
+}
@@ -0,0 +1,204 @@
+#include "texture_cooker.hpp"
+#include "ktx2.hpp"
+#include "thread_pool.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		struct Image {
+			int width = 0, height = 0;
+			std::vector<unsigned char> rgb;
+
+			const unsigned char* texel(int x, int y) const
+			{
+				x = std::min(x, width - 1);
+				y = std::min(y, height - 1);
+				return &rgb[((size_t)y * width + x) * 3];
+			}
+		};
+
+		// Siguiente nivel con filtro de caja 2x2 (se repite el borde si la
+		// dimensión es impar)
+		Image downsample(const Image& source)
+		{
+			Image level;
+			level.width = std::max(1, source.width / 2);
+			level.height = std::max(1, source.height / 2);
+			level.rgb.resize((size_t)level.width * level.height * 3);
+			for (int y = 0; y < level.height; y++) {
+				for (int x = 0; x < level.width; x++) {
+					const unsigned char* a = source.texel(2 * x, 2 * y);
+					const unsigned char* b = source.texel(2 * x + 1, 2 * y);
+					const unsigned char* c = source.texel(2 * x, 2 * y + 1);
+					const unsigned char* d = source.texel(2 * x + 1, 2 * y + 1);
+					unsigned char* out = &level.rgb[((size_t)y * level.width + x) * 3];
+					for (int k = 0; k < 3; k++)
+						out[k] = (unsigned char)((a[k] + b[k] + c[k] + d[k] + 2) / 4);
+				}
+			}
+			return level;
+		}
+
+		uint16_t packColor(const float color[3])
+		{
+			int r = (int)(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+			int g = (int)(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f + 0.5f);
+			int b = (int)(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f + 0.5f);
+			return (uint16_t)(r << 11 | g << 5 | b);
+		}
+
+		void unpackColor(uint16_t packed, int color[3])
+		{
+			int r = packed >> 11 & 31, g = packed >> 5 & 63, b = packed & 31;
+			color[0] = r << 3 | r >> 2;
+			color[1] = g << 2 | g >> 4;
+			color[2] = b << 3 | b >> 2;
+		}
+
+		// Un bloque BC1 de 4x4: los extremos son los texels más alejados a
+		// lo largo del eje principal de los colores (iteración de potencia
+		// sobre la covarianza) y cada texel toma el color más cercano de
+		// la paleta de 4
+		void compressBlock(const unsigned char block[16][3], unsigned char out[8])
+		{
+			float mean[3] = {};
+			for (int i = 0; i < 16; i++) {
+				for (int k = 0; k < 3; k++)
+					mean[k] += block[i][k] / 16.0f;
+			}
+			float covariance[6] = {};
+			for (int i = 0; i < 16; i++) {
+				float r = block[i][0] - mean[0], g = block[i][1] - mean[1], b = block[i][2] - mean[2];
+				covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+				covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+			}
+			float axis[3] = { 1.0f, 1.0f, 1.0f };
+			for (int iteration = 0; iteration < 4; iteration++) {
+				float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+				float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+				float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+				float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+				if (length < 1e-6f)
+					break;
+				axis[0] = x / length; axis[1] = y / length; axis[2] = z / length;
+			}
+			int lowest = 0, highest = 0;
+			float lowestDot = 1e30f, highestDot = -1e30f;
+			for (int i = 0; i < 16; i++) {
+				float dot = block[i][0] * axis[0] + block[i][1] * axis[1] + block[i][2] * axis[2];
+				if (dot < lowestDot) { lowestDot = dot; lowest = i; }
+				if (dot > highestDot) { highestDot = dot; highest = i; }
+			}
+			float high[3] = { (float)block[highest][0], (float)block[highest][1], (float)block[highest][2] };
+			float low[3] = { (float)block[lowest][0], (float)block[lowest][1], (float)block[lowest][2] };
+			uint16_t color0 = packColor(high), color1 = packColor(low);
+			// color0 > color1 selecciona el modo de 4 colores
+			if (color0 < color1)
+				std::swap(color0, color1);
+
+			uint32_t indices = 0;
+			if (color0 != color1) {
+				int palette[4][3];
+				unpackColor(color0, palette[0]);
+				unpackColor(color1, palette[1]);
+				for (int k = 0; k < 3; k++) {
+					palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+					palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+				}
+				for (int i = 0; i < 16; i++) {
+					int best = 0, bestDistance = 1 << 30;
+					for (int p = 0; p < 4; p++) {
+						int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+						int distance = dr * dr + dg * dg + db * db;
+						if (distance < bestDistance) { bestDistance = distance; best = p; }
+					}
+					indices |= (uint32_t)best << (2 * i);
+				}
+			}
+			out[0] = (unsigned char)color0; out[1] = (unsigned char)(color0 >> 8);
+			out[2] = (unsigned char)color1; out[3] = (unsigned char)(color1 >> 8);
+			for (int i = 0; i < 4; i++)
+				out[4 + i] = (unsigned char)(indices >> (8 * i));
+		}
+
+		std::vector<unsigned char> compressLevel(const Image& image)
+		{
+			int blocksX = (image.width + 3) / 4, blocksY = (image.height + 3) / 4;
+			std::vector<unsigned char> blocks((size_t)blocksX * blocksY * 8);
+			unsigned char block[16][3];
+			for (int by = 0; by < blocksY; by++) {
+				for (int bx = 0; bx < blocksX; bx++) {
+					for (int i = 0; i < 16; i++) {
+						const unsigned char* texel = image.texel(bx * 4 + i % 4, by * 4 + i / 4);
+						for (int k = 0; k < 3; k++)
+							block[i][k] = texel[k];
+					}
+					compressBlock(block, &blocks[((size_t)by * blocksX + bx) * 8]);
+				}
+			}
+			return blocks;
+		}
+
+	}
+
+	std::string cookedTexturePath(const std::string& source)
+	{
+		size_t dot = source.find_last_of('.');
+		size_t slash = source.find_last_of("/\\");
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return source + ".ktx2";
+		return source.substr(0, dot) + ".ktx2";
+	}
+
+	bool cookTexture(const std::string& source, const std::string& output)
+	{
+		Image image;
+		int channels = 0;
+		unsigned char* pixels = stbi_load(source.c_str(), &image.width, &image.height, &channels, 3);
+		if (!pixels) {
+			std::cout << "Error al cargar textura: " << source << std::endl;
+			return false;
+		}
+		image.rgb.assign(pixels, pixels + (size_t)image.width * image.height * 3);
+		stbi_image_free(pixels);
+
+		std::vector<std::vector<unsigned char>> levels;
+		int width = image.width, height = image.height;
+		for (;;) {
+			levels.push_back(compressLevel(image));
+			if (image.width == 1 && image.height == 1)
+				break;
+			image = downsample(image);
+		}
+		if (!writeKtx2(output, KTX2_BC1_RGB_UNORM, width, height, levels)) {
+			std::cout << "Error al escribir " << output << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	int cookTextures(const std::vector<std::string>& sources, ThreadPool& pool)
+	{
+		// La opción de stb es global: se fija antes de repartir el trabajo
+		stbi_set_flip_vertically_on_load(true);
+		std::atomic<int> failed(0);
+		pool.parallelFor(sources.size(), 1, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				std::string output = cookedTexturePath(sources[i]);
+				if (cookTexture(sources[i], output))
+					std::cout << sources[i] << " -> " << output << std::endl;
+				else
+					failed++;
+			}
+		});
+		return failed;
+	}
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace myopengl {
+
+	class ThreadPool;
+
+	// Ruta del archivo cocinado para una imagen: misma carpeta y nombre,
+	// extensión .ktx2 (textures/wood.jpg -> textures/wood.ktx2)
+	std::string cookedTexturePath(const std::string& source);
+
+	// Convierte una imagen a KTX2 con la cadena de mipmaps completa
+	// (filtro de caja, como glGenerateMipmap) comprimida en BC1. La imagen
+	// se invierte verticalmente igual que en la carga en tiempo de
+	// ejecución. Devuelve false e imprime el error si falla.
+	bool cookTexture(const std::string& source, const std::string& output);
+
+	// Cocina varias imágenes en paralelo; devuelve cuántas fallaron
+	int cookTextures(const std::vector<std::string>& sources, ThreadPool& pool);
+
+}
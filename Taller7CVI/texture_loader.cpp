@@ -0,0 +1,363 @@
+#include "texture_loader.hpp"
+#include "thread_pool.hpp"
+#include "texture_cooker.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace myopengl {
+
+	namespace {
+
+		// Lee un byte por página para que el sistema las traiga a memoria
+		// en este hilo y no durante la subida en el hilo de render
+		void touchPages(const unsigned char* data, size_t size)
+		{
+			volatile unsigned char sink = 0;
+			for (size_t offset = 0; offset < size; offset += 4096)
+				sink ^= data[offset];
+			(void)sink;
+		}
+
+	}
+
+	TextureLoader::~TextureLoader()
+	{
+		destroy();
+	}
+
+	void TextureLoader::create(ThreadPool& threadPool, size_t frameBudget)
+	{
+		destroy();
+		pool = &threadPool;
+		budget = frameBudget;
+		// Provisoria: 2x2 en grises, visible como tal pero sin desentonar
+		const unsigned char checker[] = { 96, 96, 96, 160, 160, 160, 160, 160, 160, 96, 96, 96 };
+		glGenTextures(1, &placeholder);
+		glBindTexture(GL_TEXTURE_2D, placeholder);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 2, 2, 0, GL_RGB, GL_UNSIGNED_BYTE, checker);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glGenBuffers(1, &pixelBuffer);
+		compressedFormats.clear();
+		for (uint32_t format : { KTX2_BC1_RGB_UNORM, KTX2_BC1_RGBA_UNORM, KTX2_BC7_UNORM, KTX2_ETC2_RGB8_UNORM }) {
+			if (ktx2FormatSupported(format))
+				compressedFormats.push_back(format);
+		}
+	}
+
+	void TextureLoader::destroy()
+	{
+		// Las tareas en vuelo escriben en este objeto: hay que esperarlas
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			decodedSignal.wait(lock, [this]() { return decodingCount == 0; });
+			for (Decoded& job : decoded)
+				stbi_image_free(job.pixels);
+			decoded.clear();
+		}
+		if (uploading) {
+			stbi_image_free(current.pixels);
+			if (current.texture)
+				glDeleteTextures(1, &current.texture);
+			current = Decoded();
+			uploading = false;
+		}
+		for (Entry& entry : entries) {
+			if (entry.texture)
+				glDeleteTextures(1, &entry.texture);
+		}
+		entries.clear();
+		byContent.clear();
+		if (placeholder)
+			glDeleteTextures(1, &placeholder);
+		if (pixelBuffer)
+			glDeleteBuffers(1, &pixelBuffer);
+		placeholder = 0;
+		pixelBuffer = 0;
+		loaderStats = TextureLoaderStats();
+	}
+
+	int TextureLoader::load(const std::string& path)
+	{
+		int handle = (int)entries.size();
+		Entry entry;
+		entry.path = path;
+		entries.push_back(entry);
+		loaderStats.requested++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			decodingCount++;
+		}
+		// La opción de stb es global: se fija aquí, en el hilo principal
+		stbi_set_flip_vertically_on_load(true);
+		pool->submit([this, handle, path]() {
+			Decoded job;
+			job.handle = handle;
+			decode(job, path);
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_back(std::move(job));
+			decodingCount--;
+			decodedSignal.notify_all();
+		});
+		return handle;
+	}
+
+	bool TextureLoader::useCooked(Decoded& job, const unsigned char* data, size_t size)
+	{
+		if (!parseKtx2(data, size, job.cooked)
+			|| std::find(compressedFormats.begin(), compressedFormats.end(), job.cooked.format) == compressedFormats.end())
+			return false;
+		job.cookedData = data;
+		job.width = job.cooked.width;
+		job.height = job.cooked.height;
+		return true;
+	}
+
+	void TextureLoader::decode(Decoded& job, const std::string& path)
+	{
+		// Primero el paquete: los bytes ya están proyectados y su hash,
+		// precalculado; solo se traen las páginas
+		const AssetBlob* blob = pack ? pack->find(cookedTexturePath(path)) : nullptr;
+		if (blob && blob->kind == ASSET_KTX2 && useCooked(job, blob->data, blob->size)) {
+			touchPages(blob->data, blob->size);
+			job.hash = blob->hash;
+			return;
+		}
+		blob = pack ? pack->find(path) : nullptr;
+		if (blob && blob->kind == ASSET_IMAGE) {
+			job.hash = blob->hash;
+			job.pixels = stbi_load_from_memory(blob->data, (int)blob->size, &job.width, &job.height, &job.channels, 0);
+			return;
+		}
+
+		// Versión cocinada suelta: el hash recorre la proyección entera, así
+		// que además trae las páginas a memoria fuera del hilo de render
+		std::unique_ptr<MappedFile> file(new MappedFile());
+		if (file->open(cookedTexturePath(path)) && useCooked(job, file->data(), file->size())) {
+			job.hash = hashContent(file->data(), file->size());
+			job.file = std::move(file);
+			return;
+		}
+		// Se lee el archivo entero para poder identificar su contenido
+		std::ifstream source(path, std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+		if (!bytes.empty()) {
+			job.hash = hashContent(bytes.data(), bytes.size());
+			job.pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(),
+				&job.width, &job.height, &job.channels, 0);
+		}
+	}
+
+	size_t TextureLoader::uploadRows(Decoded& job, size_t bytes)
+	{
+		static const GLenum formats[] = { GL_RED, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		static const GLenum internalFormats[] = { GL_R8, GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		GLenum format = formats[job.channels];
+		size_t rowBytes = (size_t)job.width * job.channels;
+		if (!job.texture) {
+			glGenTextures(1, &job.texture);
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[job.channels], job.width, job.height, 0,
+				format, GL_UNSIGNED_BYTE, NULL);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+		// Se recorta en size_t: con el presupuesto sin límite de finish() la
+		// división no cabe en un int
+		int rows = (int)std::max<size_t>(1, std::min<size_t>(job.height - job.rowsUploaded, bytes / rowBytes));
+		size_t size = rows * rowBytes;
+
+		// El PBO se huérfana en cada trozo: el driver copia a la textura
+		// de forma asíncrona mientras se llena el siguiente
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (mapped) {
+			memcpy(mapped, job.pixels + job.rowsUploaded * rowBytes, size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, job.rowsUploaded, job.width, rows, format, GL_UNSIGNED_BYTE, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		job.rowsUploaded += rows;
+		return size;
+	}
+
+	size_t TextureLoader::uploadLevels(Decoded& job, size_t bytes)
+	{
+		const std::vector<Ktx2Level>& levels = job.cooked.levels;
+		if (!job.texture) {
+			glGenTextures(1, &job.texture);
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+				levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);
+		}
+		glBindTexture(GL_TEXTURE_2D, job.texture);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+		size_t uploaded = 0;
+		// Los bloques se copian de la proyección del archivo al PBO, sin
+		// pasar por memoria propia
+		while (job.levelsUploaded < (int)levels.size()) {
+			const Ktx2Level& level = levels[job.levelsUploaded];
+			if (uploaded > 0 && uploaded + level.size > bytes)
+				break;
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, level.size, NULL, GL_STREAM_DRAW);
+			void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, level.size,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (mapped) {
+				memcpy(mapped, job.cookedData + level.offset, level.size);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				glCompressedTexImage2D(GL_TEXTURE_2D, job.levelsUploaded, job.cooked.glFormat, level.width, level.height,
+					0, (GLsizei)level.size, 0);
+			}
+			uploaded += level.size;
+			job.levelsUploaded++;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return uploaded;
+	}
+
+	void TextureLoader::update()
+	{
+		loaderStats.frameBytes = 0;
+		for (;;) {
+			if (!uploading) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (decoded.empty())
+					break;
+				current = std::move(decoded.front());
+				decoded.pop_front();
+				uploading = true;
+				Entry& entry = entries[current.handle];
+				if (entry.released) {
+					stbi_image_free(current.pixels);
+					current = Decoded();
+					uploading = false;
+					continue;
+				}
+				entry.hash = current.hash;
+				// Contenido repetido: se comparte el original en vez de subirlo
+				auto found = byContent.find(current.hash);
+				bool valid = current.pixels || current.cookedData;
+				if (valid && found != byContent.end()) {
+					stbi_image_free(current.pixels);
+					current = Decoded();
+					entry.original = found->second;
+					loaderStats.duplicates++;
+					uploading = false;
+					continue;
+				}
+				if (valid)
+					byContent[current.hash] = current.handle;
+			}
+			if (!current.cookedData && (!current.pixels || current.channels < 1 || current.channels > 4)) {
+				std::cout << "Error al cargar textura: " << entries[current.handle].path << std::endl;
+				stbi_image_free(current.pixels);
+				entries[current.handle].failed = true;
+				loaderStats.failed++;
+				uploading = false;
+				continue;
+			}
+			// Siempre al menos una fila, aunque el presupuesto esté agotado
+			if (loaderStats.frameBytes > 0 && loaderStats.frameBytes >= budget)
+				break;
+			size_t remaining = budget > loaderStats.frameBytes ? budget - loaderStats.frameBytes : 0;
+			Entry& entry = entries[current.handle];
+			if (current.cookedData) {
+				size_t bytes = uploadLevels(current, remaining);
+				loaderStats.frameBytes += bytes;
+				loaderStats.totalBytes += bytes;
+				entry.bytes += bytes;
+				if (current.levelsUploaded < (int)current.cooked.levels.size())
+					continue;
+				loaderStats.cooked++;
+			}
+			else {
+				size_t bytes = uploadRows(current, remaining);
+				loaderStats.frameBytes += bytes;
+				loaderStats.totalBytes += bytes;
+				if (current.rowsUploaded < current.height)
+					continue;
+				glBindTexture(GL_TEXTURE_2D, current.texture);
+				glGenerateMipmap(GL_TEXTURE_2D);
+				stbi_image_free(current.pixels);
+				entry.bytes = (size_t)current.width * current.height * current.channels * 4 / 3;
+			}
+			entry.texture = current.texture;
+			current = Decoded();
+			loaderStats.ready++;
+			uploading = false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		loaderStats.decoding = decodingCount;
+		loaderStats.queued = (int)decoded.size() + (uploading ? 1 : 0);
+	}
+
+	void TextureLoader::finish()
+	{
+		size_t savedBudget = budget;
+		budget = (size_t)-1;
+		while (!idle()) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				decodedSignal.wait(lock, [this]() { return decodingCount == 0 || !decoded.empty(); });
+			}
+			update();
+		}
+		budget = savedBudget;
+	}
+
+	bool TextureLoader::idle() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return decodingCount == 0 && decoded.empty() && !uploading;
+	}
+
+	void TextureLoader::release(int handle)
+	{
+		Entry& entry = entries[handle];
+		if (entry.released)
+			return;
+		entry.released = true;
+		auto found = byContent.find(entry.hash);
+		if (found != byContent.end() && found->second == handle)
+			byContent.erase(found);
+		if (uploading && current.handle == handle) {
+			stbi_image_free(current.pixels);
+			glDeleteTextures(1, &current.texture);
+			current = Decoded();
+			uploading = false;
+		}
+		if (entry.texture) {
+			glDeleteTextures(1, &entry.texture);
+			loaderStats.ready--;
+		}
+		entry.texture = 0;
+		entry.bytes = 0;
+		entry.original = -1;
+	}
+
+	GLuint TextureLoader::texture(int handle) const
+	{
+		const Entry& entry = entries[handle];
+		GLuint id = entry.original >= 0 ? entries[entry.original].texture : entry.texture;
+		return id ? id : placeholder;
+	}
+
+}
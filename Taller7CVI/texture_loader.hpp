@@ -0,0 +1,141 @@
+#pragma once
+#include <GL/glew.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "asset_pack.hpp"
+#include "ktx2.hpp"
+#include "mapped_file.hpp"
+
+namespace myopengl {
+
+	class ThreadPool;
+
+	struct TextureLoaderStats {
+		int requested = 0;
+		int ready = 0;
+		int failed = 0;
+		int duplicates = 0;         // mismo contenido que otra ya subida
+		int cooked = 0;             // leídas de un .ktx2 comprimido
+		int decoding = 0;           // en el grupo de hilos
+		int queued = 0;             // decodificadas, esperando subida
+		size_t frameBytes = 0;      // subidos en el último update()
+		size_t totalBytes = 0;
+	};
+
+	// Carga de texturas en segundo plano. load() vuelve enseguida con un
+	// identificador: la imagen se decodifica en el grupo de hilos y el hilo
+	// de render la sube por partes (filas) a través de un pixel buffer
+	// object, sin pasar de frameBudget bytes por frame. Hasta que la subida
+	// termina, texture() devuelve una textura provisoria compartida, así
+	// que el primer frame no espera a ninguna imagen.
+	//
+	// Si junto a la imagen hay un .ktx2 cocinado (ver texture_cooker.hpp) y
+	// la GPU soporta su formato, se proyecta en memoria y sus mipmaps
+	// comprimidos se suben nivel por nivel, sin decodificar ni generar
+	// mipmaps; si no, se decodifica la imagen original. Con un paquete de
+	// recursos (setPack) se busca ahí antes que en los archivos sueltos.
+	class TextureLoader {
+	public:
+		TextureLoader() = default;
+		~TextureLoader();
+		TextureLoader(const TextureLoader&) = delete;
+		TextureLoader& operator=(const TextureLoader&) = delete;
+
+		void create(ThreadPool& pool, size_t frameBudget);
+		// Paquete donde buscar primero (nullptr: solo archivos sueltos).
+		// Tiene que seguir abierto mientras haya cargas pendientes.
+		void setPack(const AssetPack* assetPack) { pack = assetPack; }
+		// Espera las decodificaciones en curso y libera las texturas
+		void destroy();
+
+		// Encola la lectura del .ktx2 o la decodificación de la imagen
+		// (invertida verticalmente)
+		int load(const std::string& path);
+		// Sube lo decodificado hasta agotar el presupuesto; una vez por
+		// frame en el hilo de GL. Siempre avanza al menos una fila.
+		void update();
+		// Espera y sube todo lo pendiente (herramientas y benchmarks)
+		void finish();
+
+		// Libera la textura (o descarta la decodificación pendiente). El
+		// identificador no se reutiliza; texture() devuelve la provisoria.
+		void release(int handle);
+
+		GLuint texture(int handle) const;
+		GLuint placeholderTexture() const { return placeholder; }
+		bool ready(int handle) const { return texture(handle) != placeholder; }
+		bool idle() const;
+		// Si el archivo decodificado resultó idéntico (mismo hash de los
+		// bytes del archivo) a otro ya subido, no se sube de nuevo: devuelve
+		// el identificador del original, o -1
+		int original(int handle) const { return entries[handle].original; }
+		// Hash FNV-1a de los bytes del archivo (0 hasta que se decodifica)
+		uint64_t contentHash(int handle) const { return entries[handle].hash; }
+		// Memoria de GPU estimada, con mipmaps (0 si no está lista o es copia)
+		size_t residentBytes(int handle) const { return entries[handle].bytes; }
+
+		void setFrameBudget(size_t bytes) { budget = bytes; }
+		size_t frameBudget() const { return budget; }
+		const TextureLoaderStats& stats() const { return loaderStats; }
+
+	private:
+		struct Entry {
+			std::string path;
+			GLuint texture = 0; // 0 mientras no esté lista
+			uint64_t hash = 0;
+			size_t bytes = 0;
+			int original = -1;
+			bool failed = false;
+			bool released = false;
+		};
+
+		// Imagen decodificada y el avance de su subida
+		struct Decoded {
+			int handle = 0;
+			int width = 0, height = 0, channels = 0;
+			unsigned char* pixels = nullptr;
+			uint64_t hash = 0;
+			GLuint texture = 0;
+			int rowsUploaded = 0;
+			// Versión cocinada: cookedData apunta al paquete o a file, que
+			// sigue abierto hasta terminar la subida
+			std::unique_ptr<MappedFile> file;
+			const unsigned char* cookedData = nullptr;
+			Ktx2Image cooked;
+			int levelsUploaded = 0;
+		};
+
+		// En un hilo del grupo: lee o decodifica la imagen de path
+		void decode(Decoded& job, const std::string& path);
+		bool useCooked(Decoded& job, const unsigned char* data, size_t size);
+		// Sube filas de job hasta bytes; devuelve los bytes subidos
+		size_t uploadRows(Decoded& job, size_t bytes);
+		// Sube niveles comprimidos (al menos uno) hasta bytes
+		size_t uploadLevels(Decoded& job, size_t bytes);
+
+		ThreadPool* pool = nullptr;
+		const AssetPack* pack = nullptr;
+		size_t budget = 0;
+		std::vector<uint32_t> compressedFormats; // formatos KTX2 que acepta la GPU
+		GLuint placeholder = 0;
+		GLuint pixelBuffer = 0;
+		std::vector<Entry> entries;
+		std::unordered_map<uint64_t, int> byContent; // hash -> original subido
+		Decoded current;            // subida en curso (solo hilo de GL)
+		bool uploading = false;
+
+		mutable std::mutex mutex;   // protege decoded y decodingCount
+		std::condition_variable decodedSignal;
+		std::deque<Decoded> decoded;
+		int decodingCount = 0;
+
+		TextureLoaderStats loaderStats;
+	};
+
+}
@@ -0,0 +1,119 @@
+#include "thread_pool.hpp"
+#include <atomic>
+#include <memory>
+
+namespace myopengl {
+
+	ThreadPool::~ThreadPool()
+	{
+		destroy();
+	}
+
+	void ThreadPool::create(int threadCount)
+	{
+		destroy();
+		if (threadCount <= 0)
+			threadCount = (int)std::thread::hardware_concurrency() - 1;
+		stopping = false;
+		for (int i = 0; i < threadCount; i++)
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	void ThreadPool::destroy()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+		workers.clear();
+		queue.clear();
+	}
+
+	void ThreadPool::submit(Task task)
+	{
+		if (workers.empty()) {
+			task();
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(task));
+		}
+		wake.notify_one();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		for (;;) {
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+				if (stopping && queue.empty())
+					return;
+				task = std::move(queue.front());
+				queue.pop_front();
+			}
+			task();
+		}
+	}
+
+	// Estado compartido de un parallelFor. Vive en el heap porque un hilo
+	// que toma su tarea tarde (detrás de otra tarea larga) puede llegar
+	// cuando parallelFor ya volvió; en ese caso ya no quedan bloques y sale.
+	struct RangeJob {
+		ThreadPool::RangeTask task;
+		size_t count = 0;
+		size_t batch = 0;
+		size_t batches = 0;
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		std::mutex mutex;
+		std::condition_variable finished;
+
+		void run()
+		{
+			size_t completed = 0;
+			for (size_t index = next++; index < batches; index = next++) {
+				size_t begin = index * batch;
+				size_t end = begin + batch < count ? begin + batch : count;
+				task(begin, end);
+				completed++;
+			}
+			if (completed && (done += completed) == batches) {
+				std::lock_guard<std::mutex> lock(mutex);
+				finished.notify_all();
+			}
+		}
+	};
+
+	void ThreadPool::parallelFor(size_t count, size_t minBatch, const RangeTask& task)
+	{
+		if (count == 0)
+			return;
+		size_t maxBatches = workers.size() + 1;
+		size_t batches = (count + minBatch - 1) / minBatch;
+		if (batches > maxBatches)
+			batches = maxBatches;
+		if (batches <= 1) {
+			task(0, count);
+			return;
+		}
+
+		std::shared_ptr<RangeJob> job = std::make_shared<RangeJob>();
+		job->task = task;
+		job->count = count;
+		job->batch = (count + batches - 1) / batches;
+		job->batches = (count + job->batch - 1) / job->batch;
+		for (size_t i = 1; i < job->batches; i++)
+			submit([job]() { job->run(); });
+		job->run();
+
+		std::unique_lock<std::mutex> lock(job->mutex);
+		job->finished.wait(lock, [&job]() { return job->done == job->batches; });
+	}
+
+}
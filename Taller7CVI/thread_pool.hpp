@@ -0,0 +1,48 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace myopengl {
+
+	// Grupo de hilos persistente. Los hilos se crean una vez y esperan
+	// tareas en una cola, así que repartir trabajo cada frame no paga el
+	// costo de crear hilos.
+	class ThreadPool {
+	public:
+		typedef std::function<void()> Task;
+		typedef std::function<void(size_t begin, size_t end)> RangeTask;
+
+		ThreadPool() = default;
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// threadCount = 0: un hilo por núcleo, menos el hilo principal
+		void create(int threadCount = 0);
+		void destroy();
+
+		// Encola una tarea sin esperar su resultado
+		void submit(Task task);
+		// Divide [0, count) en bloques de al menos minBatch elementos y los
+		// reparte entre los hilos; el hilo que llama también trabaja y la
+		// función vuelve cuando todos los bloques terminaron.
+		void parallelFor(size_t count, size_t minBatch, const RangeTask& task);
+
+		int threads() const { return (int)workers.size(); }
+
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> workers;
+		std::deque<Task> queue;
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false;
+	};
+
+}
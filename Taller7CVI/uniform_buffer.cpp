@@ -0,0 +1,37 @@
+#include "uniform_buffer.hpp"
+
+namespace myopengl {
+
+	UniformBuffer::~UniformBuffer()
+	{
+		destroy();
+	}
+
+	void UniformBuffer::create(GLsizeiptr size, GLuint binding)
+	{
+		destroy();
+		capacity = size;
+		bindingPoint = binding;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+	}
+
+	void UniformBuffer::update(const void* data, GLsizeiptr size, GLintptr offset)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		if (offset == 0 && size == capacity)
+			glBufferData(GL_UNIFORM_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+	}
+
+	void UniformBuffer::destroy()
+	{
+		if (buffer)
+			glDeleteBuffers(1, &buffer);
+		buffer = 0;
+		capacity = 0;
+	}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <GL/glew.h>
+
+namespace myopengl {
+
+	// Puntos de enlace fijos de los bloques uniform compartidos
+	enum UniformBinding : GLuint {
+		FRAME_DATA_BINDING = 0,
+		MATERIALS_BINDING = 1
+	};
+
+	// Buffer de uniforms (UBO) enlazado a un punto fijo. Varios programas
+	// comparten los mismos datos enlazando su bloque al mismo punto.
+	class UniformBuffer {
+	public:
+		UniformBuffer() = default;
+		~UniformBuffer();
+		UniformBuffer(const UniformBuffer&) = delete;
+		UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+		void create(GLsizeiptr size, GLuint binding);
+		// Reemplaza [offset, offset + size). Si se reescribe todo el buffer
+		// se descarta el contenido anterior para no esperar a la GPU.
+		void update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+		void destroy();
+
+		GLuint id() const { return buffer; }
+		GLuint binding() const { return bindingPoint; }
+
+	private:
+		GLuint buffer = 0;
+		GLuint bindingPoint = 0;
+		GLsizeiptr capacity = 0;
+	};
+
+}